@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+
+#include "inttypes.hpp"
+
+namespace chess
+{
+    // Compile time square set tables shared by move generation and evaluation.
+    // Squares are a1 = 0 .. h8 = 63, colors indexed white = 0, black = 1.
+    namespace bitboard
+    {
+        constexpr u64 FILE_A = 0x0101010101010101ULL;
+        constexpr u64 FILE_H = FILE_A << 7;
+        constexpr u64 RANK_1 = 0xFFULL;
+        constexpr u64 RANK_8 = RANK_1 << 56;
+
+        inline constexpr u64 square_bb(int sq) { return 1ULL << sq; }
+
+        namespace detail
+        {
+            constexpr std::array<u64, 8> make_file_mask()
+            {
+                std::array<u64, 8> t{};
+                for (int f = 0; f < 8; ++f)
+                    t[f] = FILE_A << f;
+                return t;
+            }
+
+            constexpr std::array<u64, 8> make_adjacent_files()
+            {
+                std::array<u64, 8> t{};
+                for (int f = 0; f < 8; ++f)
+                    t[f] = (f > 0 ? FILE_A << (f - 1) : 0) | (f < 7 ? FILE_A << (f + 1) : 0);
+                return t;
+            }
+
+            constexpr std::array<std::array<u64, 8>, 2> make_forward_ranks()
+            {
+                std::array<std::array<u64, 8>, 2> t{};
+                for (int r = 0; r < 8; ++r)
+                {
+                    for (int other = 0; other < 8; ++other)
+                    {
+                        if (other > r)
+                            t[0][r] |= RANK_1 << (8 * other);
+                        if (other < r)
+                            t[1][r] |= RANK_1 << (8 * other);
+                    }
+                }
+                return t;
+            }
+
+            // Squares from a (exclusive) towards b (exclusive) if they share a rank, file or diagonal,
+            // with full set to the whole line through both instead
+            constexpr u64 ray(int a, int b, bool full)
+            {
+                const int ra = a / 8, fa = a % 8, rb = b / 8, fb = b % 8;
+                const int dr = (rb > ra) - (rb < ra), df = (fb > fa) - (fb < fa);
+                if (a == b || !(ra == rb || fa == fb || ra - rb == fa - fb || ra - rb == fb - fa))
+                    return 0;
+
+                if (!full)
+                {
+                    u64 bb = 0;
+                    for (int r = ra + dr, f = fa + df; r != rb || f != fb; r += dr, f += df)
+                        bb |= 1ULL << (r * 8 + f);
+                    return bb;
+                }
+
+                u64 bb = 1ULL << a;
+                for (int r = ra + dr, f = fa + df; r >= 0 && r < 8 && f >= 0 && f < 8; r += dr, f += df)
+                    bb |= 1ULL << (r * 8 + f);
+                for (int r = ra - dr, f = fa - df; r >= 0 && r < 8 && f >= 0 && f < 8; r -= dr, f -= df)
+                    bb |= 1ULL << (r * 8 + f);
+                return bb;
+            }
+
+            constexpr std::array<std::array<u64, 64>, 64> make_rays(bool full)
+            {
+                std::array<std::array<u64, 64>, 64> t{};
+                for (int a = 0; a < 64; ++a)
+                {
+                    for (int b = 0; b < 64; ++b)
+                        t[a][b] = ray(a, b, full);
+                }
+                return t;
+            }
+        } // namespace detail
+
+        inline constexpr std::array<u64, 8> file_mask = detail::make_file_mask();
+        inline constexpr std::array<u64, 8> adjacent_files = detail::make_adjacent_files();          // neighbouring files, not the file itself
+        inline constexpr std::array<std::array<u64, 8>, 2> forward_ranks = detail::make_forward_ranks(); // ranks strictly ahead of [color][rank]
+
+        // Squares an enemy pawn must not occupy for a [color] pawn on [square] to be passed:
+        // its own and the adjacent files, ranks ahead of it
+        inline constexpr std::array<std::array<u64, 64>, 2> passed_mask = []
+        {
+            std::array<std::array<u64, 64>, 2> t{};
+            for (int c = 0; c < 2; ++c)
+            {
+                for (int sq = 0; sq < 64; ++sq)
+                    t[c][sq] = forward_ranks[c][sq / 8] & (file_mask[sq % 8] | adjacent_files[sq % 8]);
+            }
+            return t;
+        }();
+
+        inline constexpr std::array<std::array<u64, 64>, 64> between = detail::make_rays(false); // squares strictly between two aligned squares
+        inline constexpr std::array<std::array<u64, 64>, 64> line = detail::make_rays(true);     // full line through two aligned squares (0 if not aligned)
+    } // namespace bitboard
+} // namespace chess
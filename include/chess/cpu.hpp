@@ -0,0 +1,50 @@
+#pragma once
+
+#include <initializer_list>
+
+#include "inttypes.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHESS_X86
+#endif
+
+namespace chess
+{
+    // Runtime dispatch of SIMD kernels. The kernels are compiled for their instruction set with
+    // __attribute__((target(...))), so one binary runs everywhere and picks the widest set the host has.
+    namespace cpu
+    {
+        namespace feature
+        {
+            constexpr u8 POPCNT = 0b001;
+            constexpr u8 SSE41 = 0b010;
+            constexpr u8 AVX2 = 0b100;
+        } // namespace feature
+
+        // Features of the host, detected on first use (always 0 off x86)
+        u8 features();
+
+        template <typename Kernels>
+        struct Candidate
+        {
+            u8 required; // feature bits the kernels were compiled for
+            Kernels kernels;
+        };
+
+        // Kernels of the first candidate the host supports, widest first, the last one should require nothing
+        template <typename Kernels>
+        Kernels select(std::initializer_list<Candidate<Kernels>> candidates)
+        {
+            const Candidate<Kernels> *chosen = candidates.end() - 1;
+            for (const Candidate<Kernels> &c : candidates)
+            {
+                if ((features() & c.required) == c.required)
+                {
+                    chosen = &c;
+                    break;
+                }
+            }
+            return chosen->kernels;
+        }
+    } // namespace cpu
+} // namespace chess
@@ -7,6 +7,7 @@
 #include <string>
 
 #include "chess/position.hpp"
+#include "chess/perft.hpp"
 
 namespace chess
 {
@@ -86,26 +87,5 @@ namespace chess
         return debug_print(os, pos);
     }
 
-    inline u64 perft(Position &pos, int depth)
-    {
-        if (depth == 0)
-            return 1;
-
-        Move moves[256];
-        size_t move_count = get_moves(pos, moves);
-
-        u64 nodes = 0;
-
-        for (size_t i = 0; i < move_count; ++i)
-        {
-            UndoState undo;
-            pos.make_move(moves[i], undo); // Fast make_move without recomputing attacks
-            nodes += perft(pos, depth - 1);
-            pos.undo_move(undo);
-        }
-
-        return nodes;
-    }
-
 }
 #endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "inttypes.hpp"
+
+namespace chess
+{
+    // Hash table slot shared between threads without locking. It stores key ^ data
+    // next to data, so a torn write from two racing threads simply fails the key check.
+    struct HashEntry
+    {
+        std::atomic<u64> check;
+        std::atomic<u64> data;
+
+        // Reads the slot's data, returning whether it belongs to key
+        bool probe(u64 key, u64 &out) const
+        {
+            out = data.load(std::memory_order_relaxed);
+            return (check.load(std::memory_order_relaxed) ^ out) == key;
+        }
+
+        void store(u64 key, u64 value)
+        {
+            check.store(key ^ value, std::memory_order_relaxed);
+            data.store(value, std::memory_order_relaxed);
+        }
+    };
+
+    // Largest power of two number of slot_size byte slots fitting in mb megabytes (at least one)
+    constexpr std::size_t hash_table_slots(std::size_t mb, std::size_t slot_size)
+    {
+        const std::size_t bytes = mb * 1024 * 1024;
+        std::size_t count = 1;
+        while (count <= bytes / (2 * slot_size))
+            count *= 2;
+        return count;
+    }
+} // namespace chess
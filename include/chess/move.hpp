@@ -63,7 +63,8 @@ namespace chess
             return str;
         }
 
-        inline constexpr bool is_capture(move::Move m) { return flags::get(m, flags::CAPTURE); }
+        // QUEEN_CASTLE shares the low flag bit with CAPTURE, so it has to be excluded explicitly
+        inline constexpr bool is_capture(move::Move m) { return flags::get(m, flags::CAPTURE) && flags::get(m) != flags::QUEEN_CASTLE; }
         inline constexpr bool is_promotion(move::Move m) { return flags::get(m, flags::PROMO_MASK); }
         inline constexpr bool is_castle_kingside(move::Move m) { return flags::get(m) == flags::KING_CASTLE; }
         inline constexpr bool is_castle_queenside(move::Move m) { return flags::get(m) == flags::QUEEN_CASTLE; }
@@ -71,5 +72,14 @@ namespace chess
         inline constexpr bool is_double_push(move::Move m) { return flags::get(m) == flags::DOUBLE_PUSH; }
 
         inline constexpr u8 promo_piece_index(Move m) { return 1 + ((flags::get(m) >> 1) & 0b11); }
+
+        // Coordinate notation as used by UCI, with the promotion piece appended (e.g. "e7e8q")
+        inline const std::string to_uci(Move m)
+        {
+            std::string str = to_string(m);
+            if (is_promotion(m))
+                str += "pnbrq"[promo_piece_index(m)];
+            return str;
+        }
     }
 }
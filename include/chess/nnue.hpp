@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+
+#include "inttypes.hpp"
+
+namespace chess
+{
+    // Efficiently updatable neural network evaluation, an alternative to the piece-square evaluation.
+    //
+    // Architecture: (768 -> HIDDEN) x 2 -> 1
+    //  inputs   one per (piece color relative to the perspective, piece type, square), 2 * 6 * 64,
+    //           the black perspective sees the board mirrored vertically
+    //  hidden   one accumulator per perspective, the sum of the active inputs' weight rows plus a bias,
+    //           kept up to date by Position::make_move/undo_move as pieces come and go
+    //  output   clipped ReLU of the side to move's accumulator followed by the other side's, dotted
+    //           with the output weights
+    //
+    // Network file, little endian:
+    //  char magic[4] = "CNUE", u32 hidden size (must equal HIDDEN),
+    //  i16 feature_weights[768][HIDDEN], i16 feature_bias[HIDDEN],
+    //  i16 output_weights[2 * HIDDEN], i16 output_bias
+    // Quantized with QA = 255 on the hidden layer and QB = 64 on the output layer.
+    namespace nnue
+    {
+        constexpr int INPUTS = 768;
+        constexpr int HIDDEN = 256;
+        constexpr int QA = 255;
+        constexpr int QB = 64;
+        constexpr int SCALE = 400; // network output to centipawns
+
+        struct alignas(32) Accumulator
+        {
+            i16 values[2][HIDDEN]; // [perspective][neuron]
+        };
+
+        namespace detail
+        {
+            extern bool enabled;
+            void update(Accumulator &acc, u8 color, u8 piece_type, u8 square, bool add);
+        } // namespace detail
+
+        // Loads a network file, throws std::runtime_error if it can't be read or doesn't match.
+        // Evaluation only switches to it through set_enabled.
+        void load(const std::string &path);
+        bool loaded();
+
+        // Whether positions maintain accumulators and the engine evaluates with the network,
+        // only possible once a network is loaded. Not to be changed while a search is running.
+        void set_enabled(bool enabled);
+        inline bool enabled() { return detail::enabled; }
+
+        // Instruction set of the kernels picked for this CPU: "avx2", "sse4.1" or "scalar"
+        const char *simd_name();
+
+        // Accumulator of a whole board from scratch
+        void refresh(Accumulator &acc, const u64 (&pieces)[2][6]);
+
+        // Incremental updates, no-ops while the network is disabled
+        inline void add_piece(Accumulator &acc, u8 color, u8 piece_type, u8 square)
+        {
+            if (detail::enabled)
+                detail::update(acc, color, piece_type, square, true);
+        }
+        inline void remove_piece(Accumulator &acc, u8 color, u8 piece_type, u8 square)
+        {
+            if (detail::enabled)
+                detail::update(acc, color, piece_type, square, false);
+        }
+
+        // Centipawns from the point of view of the side to move
+        int evaluate(const Accumulator &acc, u8 side_to_move);
+    } // namespace nnue
+} // namespace chess
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "chess/position.hpp"
+
+namespace chess
+{
+    struct PerftResult
+    {
+        u64 nodes = 0;
+        std::vector<std::pair<Move, u64>> divide; // node count under each root move
+    };
+
+    // Counts the leaf nodes of the legal move tree to the given depth.
+    // Moves at the last ply are counted in bulk rather than played.
+    u64 perft(Position &pos, int depth);
+
+    // Same as perft, but splits the root moves over a pool of threads and
+    // records the per root move counts. With hash_mb > 0, subtree counts are
+    // cached by (hash, depth) in a table shared between the threads.
+    PerftResult perft_divide(const Position &pos, int depth, int threads = 1, std::size_t hash_mb = 0);
+} // namespace chess
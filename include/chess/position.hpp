@@ -5,6 +5,8 @@
 
 #include "inttypes.hpp"
 #include "move.hpp"
+#include "nnue.hpp"
+#include "psqt.hpp"
 
 namespace chess
 {
@@ -36,6 +38,9 @@ namespace chess
         KING = 5,
     };
 
+    // Piece values used by static exchange evaluation (king high enough to never be traded)
+    inline constexpr int see_values[6] = {100, 320, 330, 500, 900, 20000};
+
     struct UndoState
     {
         Move move;               // The move that was made (plus flags)
@@ -45,6 +50,10 @@ namespace chess
         u8 castling_rights;   // old castling rights
         i8 en_passant_square; // old en passant target (-1 if none)
         u32 halfmove_clock;   // old halfmove clock
+        u64 key;              // old zobrist key
+        u64 pawn_key;         // old pawn zobrist key
+        psqt::Score psq;      // old material and piece-square score
+        u8 phase;             // old game phase
     };
 
     struct Position
@@ -57,11 +66,27 @@ namespace chess
         i8 en_passant_square = -1;
         u32 halfmove_clock = 0;
         u32 ply = 0;
+        u64 key = 0;      // zobrist key, kept up to date by make_move/undo_move
+        u64 pawn_key = 0; // zobrist key of the pawns alone, for the pawn structure cache
+
+        // Evaluation terms, kept up to date by make_move/undo_move
+        psqt::Score psq; // material + piece-square tables, white's point of view
+        u8 phase = 0;    // sum of psqt::phase_weights over the pieces on the board
+
+        // Network accumulator, only maintained while nnue::enabled(), refresh_accumulator() after enabling it
+        nnue::Accumulator accumulator;
 
         void make_move(const Move &move);
         void make_move(const Move &move, UndoState &undo); // creates undo to save state
         void undo_move(const UndoState &undo);
-        u64 hash() const;
+        void make_null_move(UndoState &undo); // passes the turn, side to move must not be in check
+        void undo_null_move(const UndoState &undo);
+        inline u64 hash() const { return key; }
+        u64 compute_hash() const; // full recompute from scratch
+        u64 compute_pawn_hash() const;
+        psqt::Score compute_psq() const;
+        u8 compute_phase() const;
+        void refresh_accumulator();
         std::string to_fen() const;
         void from_fen(const std::string &fen = default_fen);
 
@@ -71,15 +96,52 @@ namespace chess
 
         void compute_occupancy();
         bool validate_occupancy() const;
+        bool validate_state() const; // occupancy, zobrist keys, evaluation terms, castling/en passant and check consistency
         bool square_attacked(Color us, u8 square) const;
         u64 attacked_squares(Color us, u64 bb = ~(0ULL)) const;
+        u64 attackers_to(u8 square, u64 occ) const; // pieces of both colors attacking square, given occupancy occ
+
+        // Static exchange evaluation of the capture sequence started by move on its target square,
+        // both sides recapturing with their least valuable attacker (x-rays included)
+        int see(const Move &move) const;              // material balance for the mover, in see_values units
+        bool see_ge(const Move &move, int threshold) const; // see(move) >= threshold, with early exits
+
         bool king_checked(Color us) const;
 
+        // Whether move (flags included) is one of the legal moves here, checked on its own without
+        // generating the others. For moves found elsewhere: the hash move, killers, countermoves.
+        bool is_legal(const Move &move) const;
+
         inline u64 get_piece_bb(Color c, PieceType pt) const { return pieces[static_cast<u8>(c)][static_cast<u8>(pt)]; }
         inline bool is_occupied(u8 square) const { return all_occupancy & (1ULL << square); }
         inline bool is_occupied(Color c, u8 square) const { return occupancy[static_cast<u8>(c)] & (1ULL << square); }
         inline bool is_occupied(Color c, PieceType pt, u8 square) const { return get_piece_bb(c, pt) & (1ULL << square); }
+
+        // Type of c's piece on square, which must be occupied by c
+        inline PieceType piece_on(Color c, u8 square) const
+        {
+            u8 pt = 0;
+            while (pt < 5 && !(pieces[static_cast<u8>(c)][pt] & (1ULL << square)))
+                ++pt;
+            return static_cast<PieceType>(pt);
+        }
+    };
+
+    enum class GenType : u8
+    {
+        CAPTURES,     // captures, en passant and all promotions
+        QUIETS,       // non-captures without promotions (including castling)
+        EVASIONS,     // all legal moves while in check
+        QUIET_CHECKS, // quiets that give check
+        ALL,
     };
 
-    std::size_t get_moves(const Position &pos, Move *moves);
+    // Generates the legal moves of the requested kind, returns how many were written
+    template <GenType Type>
+    std::size_t generate(const Position &pos, Move *moves);
+
+    std::size_t get_moves(const Position &pos, Move *moves); // generate<GenType::ALL>
+
+    // Squares a knight, bishop, rook, queen or king on square attacks given occupancy (0 for pawns)
+    u64 piece_attacks(PieceType pt, u8 square, u64 occupancy);
 } // namespace chess
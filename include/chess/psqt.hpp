@@ -0,0 +1,48 @@
+#pragma once
+
+#include "inttypes.hpp"
+
+namespace chess
+{
+    // Material and piece-square terms of the evaluation, kept up to date by Position::make_move/undo_move
+    // so the evaluation only pays for the pieces a move changed
+    namespace psqt
+    {
+        // Midgame and endgame halves of a tapered score, from white's point of view
+        struct Score
+        {
+            i32 mg = 0;
+            i32 eg = 0;
+
+            inline constexpr Score &operator+=(const Score &s)
+            {
+                mg += s.mg;
+                eg += s.eg;
+                return *this;
+            }
+            inline constexpr Score &operator-=(const Score &s)
+            {
+                mg -= s.mg;
+                eg -= s.eg;
+                return *this;
+            }
+            inline constexpr bool operator==(const Score &s) const { return mg == s.mg && eg == s.eg; }
+            inline constexpr bool operator!=(const Score &s) const { return !(*this == s); }
+        };
+
+        inline constexpr int piece_values[6] = {100, 320, 330, 500, 900, 0};
+
+        // Game phase contributed by each piece (used for tapered eval), 24 with all pieces on the board
+        inline constexpr int phase_weights[6] = {0, 1, 1, 2, 4, 0};
+        constexpr int MAX_PHASE = 24;
+
+        // Material plus piece-square bonus, black's entries mirrored and negated: scores[color][piece_type][square]
+        struct Table
+        {
+            Score scores[2][6][64];
+        };
+        extern const Table table;
+
+        inline const Score &piece_square(u8 color, u8 piece_type, u8 square) { return table.scores[color][piece_type][square]; }
+    } // namespace psqt
+} // namespace chess
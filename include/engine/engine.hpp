@@ -1,5 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
 #include "chess/game.hpp"
 
 namespace chess
@@ -7,7 +12,63 @@ namespace chess
     namespace engine
     {
 
+        // Lets another thread steer a running search
+        struct SearchSignals
+        {
+            std::atomic<bool> stop{false};   // finish as soon as possible, keeping the best move so far
+            std::atomic<bool> ponder{false}; // time limits are ignored while set, the clock starts once cleared (ponderhit)
+        };
+
+        // All time values are in milliseconds, zero means "no limit"
+        struct SearchLimits
+        {
+            int depth = 0;     // maximum iteration depth
+            int movetime = 0;  // fixed time for this move
+            int wtime = 0;     // remaining clock time
+            int btime = 0;
+            int winc = 0;      // increment per move
+            int binc = 0;
+            int movestogo = 0; // moves until the next time control (0 = sudden death)
+            u64 nodes = 0;     // node budget
+
+            SearchSignals *signals = nullptr; // optional, must outlive the search
+        };
+
+        struct SearchResult
+        {
+            Move best_move = 0;    // 0 if there are no legal moves
+            Move ponder_move = 0;  // expected reply to best_move, 0 if unknown
+            std::vector<Move> pv;  // principal variation, starting with best_move
+            int score = 0;         // centipawns from the side to move's point of view
+            int mate_in = 0;       // moves until mate, negative if getting mated, 0 if no mate was found
+            int depth = 0;         // last completed iteration
+            int seldepth = 0;      // deepest ply reached, quiescence included
+            u64 nodes = 0;         // all threads
+            u64 nps = 0;
+            i64 time_ms = 0;
+            int hashfull = 0;      // transposition table usage in permille
+        };
+
+        // Called by the searching thread after every completed iteration
+        using IterationCallback = std::function<void(const SearchResult &)>;
+
+        // Iterative deepening search, stops at whichever limit is reached first
+        SearchResult solve(Game &game, const SearchLimits &limits, const IterationCallback &on_iteration = nullptr);
+
+        // Fixed depth search
         Move solve(Game &game, int depth, int *eval_centipawns = nullptr);
 
+        // Number of Lazy SMP search threads (1 = single threaded)
+        constexpr int MAX_THREADS = 256;
+        void set_threads(int threads);
+
+        // Forward pruning and reductions, both enabled by default
+        void set_null_move_pruning(bool enabled);
+        void set_late_move_reductions(bool enabled);
+
+        // Resizes the transposition table (clears all entries)
+        void set_hash_size(std::size_t mb);
+        void clear_hash();
+
     } // namespace engine
 } // namespace chess
\ No newline at end of file
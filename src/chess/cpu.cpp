@@ -0,0 +1,29 @@
+#include "chess/cpu.hpp"
+
+namespace chess
+{
+    namespace cpu
+    {
+        static u8 detect()
+        {
+            u8 f = 0;
+#ifdef CHESS_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("popcnt"))
+                f |= feature::POPCNT;
+            if (__builtin_cpu_supports("sse4.1"))
+                f |= feature::SSE41;
+            if (__builtin_cpu_supports("avx2"))
+                f |= feature::AVX2;
+#endif
+            return f;
+        }
+
+        u8 features()
+        {
+            // Function local so kernels selected during static initialization see it set up
+            static const u8 detected = detect();
+            return detected;
+        }
+    } // namespace cpu
+} // namespace chess
@@ -161,7 +161,10 @@ namespace chess
     {
         if (history.empty())
             return;
-        seen_positions[position.hash()]--;
+        // Drop positions no longer on the game's path so the map only ever holds the game itself
+        auto it = seen_positions.find(position.hash());
+        if (it != seen_positions.end() && --it->second <= 0)
+            seen_positions.erase(it);
         UndoState undo = history.back();
         history.pop_back();
         moves.pop_back();
@@ -1,9 +1,15 @@
 #include "chess/position.hpp"
+#include "chess/bitboard.hpp"
 
+#include <algorithm>
 #include <cassert>
-#include <iostream>
 #include <sstream>
 
+#ifdef CHESS_PARANOID
+#include <cstdlib>
+#include <iostream>
+#endif
+
 namespace
 {
     u64 knight_attacks[64];
@@ -179,62 +185,267 @@ namespace chess
         return square_attacked(us, king_sq);
     }
 
-    static bool is_valid(Move move, const Position &pos, Color us, PieceType piece)
+    u64 Position::attackers_to(u8 sq, u64 occ) const
     {
-        int them = 1 ^ (int)us;
-
-        u64 new_occ = pos.all_occupancy;
-        new_occ ^= (1ULL << move::from(move));
-        new_occ |= (1ULL << move::to(move));
+        const u8 white = (u8)Color::WHITE, black = (u8)Color::BLACK;
+        return (pawn_attacks[black][sq] & pieces[white][(int)PieceType::PAWN]) |
+               (pawn_attacks[white][sq] & pieces[black][(int)PieceType::PAWN]) |
+               (knight_attacks[sq] & (pieces[white][(int)PieceType::KNIGHT] | pieces[black][(int)PieceType::KNIGHT])) |
+               (king_attacks[sq] & (pieces[white][(int)PieceType::KING] | pieces[black][(int)PieceType::KING])) |
+               (diag_attacks(sq, occ) & (pieces[white][(int)PieceType::BISHOP] | pieces[black][(int)PieceType::BISHOP] |
+                                         pieces[white][(int)PieceType::QUEEN] | pieces[black][(int)PieceType::QUEEN])) |
+               (ortho_attacks(sq, occ) & (pieces[white][(int)PieceType::ROOK] | pieces[black][(int)PieceType::ROOK] |
+                                          pieces[white][(int)PieceType::QUEEN] | pieces[black][(int)PieceType::QUEEN]));
+    }
 
-        if (is_en_passant(move))
+    u64 piece_attacks(PieceType pt, u8 square, u64 occupancy)
+    {
+        switch (pt)
         {
-            int dir = (us == Color::WHITE) ? -8 : 8;
-            new_occ ^= (1ULL << (move::to(move) + dir));
+        case PieceType::KNIGHT:
+            return knight_attacks[square];
+        case PieceType::BISHOP:
+            return diag_attacks(square, occupancy);
+        case PieceType::ROOK:
+            return ortho_attacks(square, occupancy);
+        case PieceType::QUEEN:
+            return diag_attacks(square, occupancy) | ortho_attacks(square, occupancy);
+        case PieceType::KING:
+            return king_attacks[square];
+        default:
+            return 0; // pawn attacks depend on the color
         }
+    }
+
+    bool Position::is_legal(const Move &m) const
+    {
+        const Color us = turn();
+        const Color them = Color(1 ^ (u8)us);
+        const u8 from = move::from(m);
+        const u8 to = move::to(m);
+        const u64 from_bb = 1ULL << from, to_bb = 1ULL << to;
+        const move::flags::flag_t flags = move::flags::get(m);
 
-        int king_sq = (piece == PieceType::KING) ? move::to(move) : __builtin_ctzll(pos.pieces[(u8)us][(u8)PieceType::KING]);
+        if (!m || !(occupancy[(u8)us] & from_bb) || (occupancy[(u8)us] & to_bb))
+            return false;
 
-        u64 mask = ~0ULL; // mask out the peices that have been captured at each step in cases of the checking piece being captured
-        if (move::is_capture(move))
-            mask &= ~(1ULL << move::to(move));
-        if (move::is_en_passant(move))
+        const PieceType pt = piece_on(us, from);
+        const bool enemy_on_to = occupancy[(u8)them] & to_bb;
+
+        if (move::is_castle_kingside(m) || move::is_castle_queenside(m))
         {
-            int dir = (us == Color::WHITE) ? -8 : 8;
-            mask &= ~(1ULL << (move::to(move) + dir));
+            const bool kingside = move::is_castle_kingside(m);
+            const u8 right = (us == Color::WHITE) ? (kingside ? castle_rights::WK : castle_rights::WQ)
+                                                  : (kingside ? castle_rights::BK : castle_rights::BQ);
+            const u8 king_from = (us == Color::WHITE) ? 4 : 60;
+            if (pt != PieceType::KING || from != king_from || !(castling_rights & right) || to != (kingside ? from + 2 : from - 2))
+                return false;
+
+            // Same conditions as the generator: empty between king and rook, not castling out of or through check
+            const u8 rook_from = kingside ? from + 3 : from - 4;
+            const u64 crossed = kingside ? (1ULL << (from + 1)) | (1ULL << (from + 2)) : (1ULL << (from - 1)) | (1ULL << (from - 2));
+            return !(all_occupancy & bitboard::between[from][rook_from]) && !square_attacked(us, from) && !attacked_squares(us, crossed);
         }
 
-        if (pawn_attacks[(int)us][king_sq] & (pos.pieces[them][(int)PieceType::PAWN] & mask))
-            return false;
-        if (knight_attacks[king_sq] & (pos.pieces[them][(int)PieceType::KNIGHT] & mask))
-            return false;
-        if (king_attacks[king_sq] & (pos.pieces[them][(int)PieceType::KING] & mask))
+        u64 captured = enemy_on_to ? to_bb : 0;
+        if (pt == PieceType::PAWN)
+        {
+            const int up = (us == Color::WHITE) ? 8 : -8;
+            const u64 promotion_rank = (us == Color::WHITE) ? bitboard::RANK_8 : bitboard::RANK_1;
+            if (bool(to_bb & promotion_rank) != move::is_promotion(m))
+                return false;
+
+            // Promotions keep only the capture bit next to the promotion piece
+            const move::flags::flag_t kind = move::is_promotion(m) ? (flags & move::flags::CAPTURE) : flags;
+            if (move::is_en_passant(m))
+            {
+                if (en_passant_square != to || !(pawn_attacks[(u8)us][from] & to_bb))
+                    return false;
+                captured = 1ULL << (to - up);
+            }
+            else if (kind == move::flags::CAPTURE)
+            {
+                if (!enemy_on_to || !(pawn_attacks[(u8)us][from] & to_bb))
+                    return false;
+            }
+            else if (kind == move::flags::QUIET)
+            {
+                if (to != from + up || enemy_on_to)
+                    return false;
+            }
+            else if (kind == move::flags::DOUBLE_PUSH)
+            {
+                const u64 start_rank = (us == Color::WHITE) ? bitboard::RANK_1 << 8 : bitboard::RANK_8 >> 8;
+                if (!(from_bb & start_rank) || to != from + 2 * up || is_occupied(from + up) || enemy_on_to)
+                    return false;
+            }
+            else
+                return false;
+        }
+        else if (flags != (enemy_on_to ? move::flags::CAPTURE : move::flags::QUIET) || !(piece_attacks(pt, from, all_occupancy) & to_bb))
             return false;
 
-        u64 diag = diag_attacks(king_sq, new_occ);
-        if (diag & (pos.pieces[them][(int)PieceType::BISHOP] & mask))
-            return false;
-        if (diag & (pos.pieces[them][(int)PieceType::QUEEN] & mask))
-            return false;
+        // Our king must not be attacked once the move is played, by anything but the captured piece
+        const u64 occ = ((all_occupancy ^ from_bb) & ~captured) | to_bb;
+        const u8 king_sq = pt == PieceType::KING ? to : __builtin_ctzll(pieces[(u8)us][(u8)PieceType::KING]);
+        return !(attackers_to(king_sq, occ) & occupancy[(u8)them] & ~captured);
+    }
 
-        u64 ortho = ortho_attacks(king_sq, new_occ);
-        if (ortho & (pos.pieces[them][(int)PieceType::ROOK] & mask))
-            return false;
-        if (ortho & (pos.pieces[them][(int)PieceType::QUEEN] & mask))
+    // Attackers revealed on sq once occ has lost a piece: only sliders can be uncovered
+    static u64 xray_attackers(const Position &pos, u8 sq, u64 occ)
+    {
+        const u64 diag = pos.pieces[0][(int)PieceType::BISHOP] | pos.pieces[1][(int)PieceType::BISHOP] |
+                         pos.pieces[0][(int)PieceType::QUEEN] | pos.pieces[1][(int)PieceType::QUEEN];
+        const u64 ortho = pos.pieces[0][(int)PieceType::ROOK] | pos.pieces[1][(int)PieceType::ROOK] |
+                          pos.pieces[0][(int)PieceType::QUEEN] | pos.pieces[1][(int)PieceType::QUEEN];
+        return ((diag_attacks(sq, occ) & diag) | (ortho_attacks(sq, occ) & ortho)) & occ;
+    }
+
+    int Position::see(const Move &m) const
+    {
+        if (move::is_castle_kingside(m) || move::is_castle_queenside(m))
+            return 0;
+
+        const u8 from = move::from(m);
+        const u8 to = move::to(m);
+        Color side = turn();
+
+        u64 occ = all_occupancy ^ (1ULL << from);
+        int gain[32];
+        int depth = 0;
+
+        gain[0] = 0;
+        if (move::is_en_passant(m))
+        {
+            occ ^= 1ULL << (to + (side == Color::WHITE ? -8 : 8));
+            gain[0] = see_values[(int)PieceType::PAWN];
+        }
+        else if (move::is_capture(m))
+            gain[0] = see_values[(int)piece_on(Color(1 ^ (u8)side), to)];
+
+        // Value of the piece now standing on `to`, which the next capture wins
+        int on_square = see_values[(int)piece_on(side, from)];
+        if (move::is_promotion(m))
+        {
+            on_square = see_values[move::promo_piece_index(m)];
+            gain[0] += on_square - see_values[(int)PieceType::PAWN];
+        }
+
+        u64 attackers = attackers_to(to, occ) & occ;
+
+        while (depth < 31)
+        {
+            side = Color(1 ^ (u8)side);
+            u64 side_attackers = attackers & occupancy[(u8)side];
+            if (!side_attackers)
+                break;
+
+            // Least valuable attacker
+            u8 pt = 0;
+            while (!(side_attackers & pieces[(u8)side][pt]))
+                ++pt;
+
+            // The king can't recapture onto a square the other side still covers
+            if (pt == (u8)PieceType::KING && (attackers & occupancy[1 ^ (u8)side]))
+                break;
+
+            ++depth;
+            gain[depth] = on_square - gain[depth - 1]; // speculative: side captures and is recaptured
+            on_square = see_values[pt];
+
+            occ ^= 1ULL << __builtin_ctzll(side_attackers & pieces[(u8)side][pt]);
+            attackers = (attackers & occ) | xray_attackers(*this, to, occ);
+        }
+
+        // Each side may stop capturing whenever continuing would lose material
+        while (depth > 0)
+        {
+            gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+            --depth;
+        }
+
+        return gain[0];
+    }
+
+    bool Position::see_ge(const Move &m, int threshold) const
+    {
+        // Special moves are rare enough to take the full evaluation
+        if (move::is_castle_kingside(m) || move::is_castle_queenside(m) || move::is_promotion(m) || move::is_en_passant(m))
+            return see(m) >= threshold;
+
+        const u8 from = move::from(m);
+        const u8 to = move::to(m);
+        Color side = turn();
+
+        // Balance after our capture, assuming the worst (losing the moved piece) next
+        int swap = (move::is_capture(m) ? see_values[(int)piece_on(Color(1 ^ (u8)side), to)] : 0) - threshold;
+        if (swap < 0)
             return false;
 
-        return true;
+        swap = see_values[(int)piece_on(side, from)] - swap;
+        if (swap <= 0)
+            return true;
+
+        u64 occ = all_occupancy ^ (1ULL << from);
+        u64 attackers = attackers_to(to, occ) & occ;
+        bool result = true;
+
+        while (true)
+        {
+            side = Color(1 ^ (u8)side);
+            u64 side_attackers = attackers & occupancy[(u8)side];
+            if (!side_attackers)
+                break;
+
+            result = !result;
+
+            // Least valuable attacker
+            u8 pt = 0;
+            while (!(side_attackers & pieces[(u8)side][pt]))
+                ++pt;
+
+            // Capturing with the king only works if the other side has nothing left
+            if (pt == (u8)PieceType::KING)
+                return (attackers & occupancy[1 ^ (u8)side]) ? !result : result;
+
+            swap = see_values[pt] - swap;
+            if (swap < (int)result)
+                break;
+
+            occ ^= 1ULL << __builtin_ctzll(side_attackers & pieces[(u8)side][pt]);
+            attackers = (attackers & occ) | xray_attackers(*this, to, occ);
+        }
+
+        return result;
     }
 
-    std::size_t get_moves(const Position &pos, Move *moves)
+    // Legal move generation. Checkers and pinned pieces are found once up front:
+    //  - in double check only the king may move
+    //  - in single check every other move must capture the checker or block its ray
+    //  - a pinned piece may only move along the line through it and its king
+    // so the only moves needing an individual probe are king moves and en passant.
+    //
+    // Type selects which subset is emitted, resolved at compile time:
+    //  CAPTURES     captures, en passant and all promotions
+    //  QUIETS       everything else (including castling)
+    //  EVASIONS     every legal move, only valid while in check (skips castling)
+    //  QUIET_CHECKS the QUIETS that give check
+    //  ALL          every legal move
+    template <GenType Type>
+    std::size_t generate(const Position &pos, Move *moves)
     {
         assert(moves != nullptr);
 
-        if (!pos.validate_occupancy())
+#ifdef CHESS_PARANOID
+        if (!pos.validate_state())
         {
-            std::cerr << "Invalid occupancy for fen: \"" << pos.to_fen() << "\"" << std::endl;
-            assert(false);
+            std::cerr << "Invalid position passed to generate: \"" << pos.to_fen() << "\"" << std::endl;
+            std::abort();
         }
+#endif
+
+        constexpr bool gen_captures = Type == GenType::CAPTURES || Type == GenType::EVASIONS || Type == GenType::ALL;
+        constexpr bool gen_quiets = Type != GenType::CAPTURES;
 
         Color us = pos.turn();
         Color them = (Color)(1 ^ (u8)us);
@@ -245,213 +456,275 @@ namespace chess
         u64 enemy_occ = pos.occupancy[(u8)them];
         u64 empty = ~pos.all_occupancy;
 
-        auto add = [&](Move move, PieceType piece)
-        {
-            if (is_valid(move, pos, us, piece))
-                moves[move_count++] = move;
-        };
+        assert(__builtin_popcountll(pos.pieces[(u8)us][(u8)PieceType::KING]) == 1);
+        const u8 king_sq = __builtin_ctzll(pos.pieces[(u8)us][(u8)PieceType::KING]);
 
-        // --- Pawns ---
-        {
-            u64 pawns = pos.pieces[(u8)us][(u8)PieceType::PAWN];
-            int push_dir = (us == Color::WHITE) ? 8 : -8;
-            int start_rank = (us == Color::WHITE) ? 1 : 6;
-            int promotion_rank = (us == Color::WHITE) ? 7 : 0;
+        const u64 their_diag = pos.pieces[(u8)them][(u8)PieceType::BISHOP] | pos.pieces[(u8)them][(u8)PieceType::QUEEN];
+        const u64 their_ortho = pos.pieces[(u8)them][(u8)PieceType::ROOK] | pos.pieces[(u8)them][(u8)PieceType::QUEEN];
+
+        const u64 checkers = pos.attackers_to(king_sq, pos.all_occupancy) & enemy_occ;
+        assert(Type != GenType::EVASIONS || checkers);
 
-            while (pawns)
+        // Pinned pieces: our only piece between the king and an enemy slider x-raying it
+        u64 pinned = 0;
+        {
+            u64 snipers = (ortho_attacks(king_sq, enemy_occ) & their_ortho) | (diag_attacks(king_sq, enemy_occ) & their_diag);
+            while (snipers)
             {
-                u8 from = __builtin_ctzll(pawns);
-                pawns &= pawns - 1;
+                u8 sq = __builtin_ctzll(snipers);
+                snipers &= snipers - 1;
+
+                u64 blockers = bitboard::between[king_sq][sq] & pos.all_occupancy;
+                if (blockers && !(blockers & (blockers - 1)) && (blockers & own_occ))
+                    pinned |= blockers;
+            }
+        }
 
-                u8 from_rank = from / 8;
-                u8 from_file = from % 8;
+        // Destination squares by move kind
+        const u64 capture_targets = gen_captures ? enemy_occ : 0;
+        const u64 quiet_targets = gen_quiets ? empty : 0;
 
-                u8 to = from + push_dir;
-                if (to < 64 && (empty & (1ULL << to)))
-                {
-                    // Promotion
-                    if (to / 8 == promotion_rank)
-                    {
-                        add(move::make(from, to, move::flags::PROMO_Q), PieceType::PAWN);
-                        add(move::make(from, to, move::flags::PROMO_R), PieceType::PAWN);
-                        add(move::make(from, to, move::flags::PROMO_B), PieceType::PAWN);
-                        add(move::make(from, to, move::flags::PROMO_N), PieceType::PAWN);
-                    }
-                    else
-                    {
-                        add(move::make(from, to), PieceType::PAWN);
-                        // Double push
-                        if (from_rank == start_rank)
-                        {
-                            u8 to2 = from + 2 * push_dir;
-                            if (empty & (1ULL << to2))
-                                add(move::make(from, to2, move::flags::DOUBLE_PUSH), PieceType::PAWN);
-                        }
-                    }
-                }
+        // For QUIET_CHECKS: squares each piece type gives check from, and our pieces
+        // that uncover a check from one of our sliders when they step off the line
+        u64 check_squares[6] = {~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL};
+        u64 discoverers = 0;
+        u8 their_king_sq = 0;
+        if constexpr (Type == GenType::QUIET_CHECKS)
+        {
+            their_king_sq = __builtin_ctzll(pos.pieces[(u8)them][(u8)PieceType::KING]);
+            check_squares[(u8)PieceType::PAWN] = pawn_attacks[(u8)them][their_king_sq];
+            check_squares[(u8)PieceType::KNIGHT] = knight_attacks[their_king_sq];
+            check_squares[(u8)PieceType::BISHOP] = diag_attacks(their_king_sq, pos.all_occupancy);
+            check_squares[(u8)PieceType::ROOK] = ortho_attacks(their_king_sq, pos.all_occupancy);
+            check_squares[(u8)PieceType::QUEEN] = check_squares[(u8)PieceType::BISHOP] | check_squares[(u8)PieceType::ROOK];
+            check_squares[(u8)PieceType::KING] = 0;
+
+            const u64 our_diag = pos.pieces[(u8)us][(u8)PieceType::BISHOP] | pos.pieces[(u8)us][(u8)PieceType::QUEEN];
+            const u64 our_ortho = pos.pieces[(u8)us][(u8)PieceType::ROOK] | pos.pieces[(u8)us][(u8)PieceType::QUEEN];
+            u64 snipers = (ortho_attacks(their_king_sq, enemy_occ) & our_ortho) | (diag_attacks(their_king_sq, enemy_occ) & our_diag);
+            while (snipers)
+            {
+                u8 sq = __builtin_ctzll(snipers);
+                snipers &= snipers - 1;
 
-                // Captures
-                if (from_file > 0)
-                {
-                    u8 cap_left = to - 1;
-                    if (enemy_occ & (1ULL << cap_left))
-                    {
-                        if (to / 8 == promotion_rank)
-                        {
-                            add(move::make(from, cap_left, move::flags::PROMO_Q | move::flags::CAPTURE), PieceType::PAWN);
-                            add(move::make(from, cap_left, move::flags::PROMO_R | move::flags::CAPTURE), PieceType::PAWN);
-                            add(move::make(from, cap_left, move::flags::PROMO_B | move::flags::CAPTURE), PieceType::PAWN);
-                            add(move::make(from, cap_left, move::flags::PROMO_N | move::flags::CAPTURE), PieceType::PAWN);
-                        }
-                        else
-                        {
-                            add(move::make(from, cap_left, move::flags::CAPTURE), PieceType::PAWN);
-                        }
-                    }
-                    else if (pos.en_passant_square == cap_left)
-                    {
-                        add(move::make(from, cap_left, move::flags::EN_PASSANT | move::flags::CAPTURE), PieceType::PAWN);
-                    }
-                }
-                if (from_file < 7)
-                {
-                    u8 cap_right = to + 1;
-                    if (enemy_occ & (1ULL << cap_right))
-                    {
-                        if (to / 8 == promotion_rank)
-                        {
-                            add(move::make(from, cap_right, move::flags::PROMO_Q | move::flags::CAPTURE), PieceType::PAWN);
-                            add(move::make(from, cap_right, move::flags::PROMO_R | move::flags::CAPTURE), PieceType::PAWN);
-                            add(move::make(from, cap_right, move::flags::PROMO_B | move::flags::CAPTURE), PieceType::PAWN);
-                            add(move::make(from, cap_right, move::flags::PROMO_N | move::flags::CAPTURE), PieceType::PAWN);
-                        }
-                        else
-                        {
-                            add(move::make(from, cap_right, move::flags::CAPTURE), PieceType::PAWN);
-                        }
-                    }
-                    else if (pos.en_passant_square == cap_right)
-                    {
-                        add(move::make(from, cap_right, move::flags::EN_PASSANT | move::flags::CAPTURE), PieceType::PAWN);
-                    }
-                }
+                u64 blockers = bitboard::between[their_king_sq][sq] & pos.all_occupancy;
+                if (blockers && !(blockers & (blockers - 1)) && (blockers & own_occ))
+                    discoverers |= blockers;
             }
         }
 
-        // --- Knights ---
+        // Quiet targets of a piece of type pt on from that give check (everything unless QUIET_CHECKS)
+        auto checking = [&](PieceType pt, u8 from)
         {
-            u64 knights = pos.pieces[(u8)us][(u8)PieceType::KNIGHT];
-            while (knights)
-            {
-                u8 from = __builtin_ctzll(knights);
-                knights &= knights - 1;
+            if constexpr (Type != GenType::QUIET_CHECKS)
+                return ~0ULL;
+            else
+                return check_squares[(u8)pt] | ((discoverers & (1ULL << from)) ? ~bitboard::line[their_king_sq][from] : 0);
+        };
 
-                u64 targets = knight_attacks[from] & ~own_occ;
-                while (targets)
-                {
-                    u8 to = __builtin_ctzll(targets);
-                    targets &= targets - 1;
+        auto add = [&](Move move)
+        {
+            moves[move_count++] = move;
+        };
 
-                    add(move::make(from, to, (enemy_occ & (1ULL << to)) ? move::flags::CAPTURE : move::flags::QUIET), PieceType::KNIGHT);
-                }
+        auto capture_flag = [&](u8 to)
+        {
+            return (enemy_occ & (1ULL << to)) ? move::flags::CAPTURE : move::flags::QUIET;
+        };
+
+        // --- King ---
+        {
+            u64 occ_without_king = pos.all_occupancy ^ (1ULL << king_sq);
+            u64 targets = king_attacks[king_sq] & (capture_targets | (quiet_targets & checking(PieceType::KING, king_sq)));
+            while (targets)
+            {
+                u8 to = __builtin_ctzll(targets);
+                targets &= targets - 1;
+
+                // The king must be removed from the occupancy, otherwise it would hide squares behind itself from sliders
+                if (!(pos.attackers_to(to, occ_without_king) & enemy_occ))
+                    add(move::make(king_sq, to, capture_flag(to)));
             }
         }
 
-        // --- Bishops ---
+        // Double check, only the king can move
+        if (checkers & (checkers - 1))
+            return move_count;
+
+        // Squares a non-king move must land on: anywhere, or capture/block the single checker
+        const u64 check_mask = checkers ? (bitboard::between[king_sq][__builtin_ctzll(checkers)] | checkers) : ~0ULL;
+
+        // Squares a piece on `from` may move to without exposing the king
+        auto pin_mask = [&](u8 from)
+        {
+            return (pinned & (1ULL << from)) ? bitboard::line[king_sq][from] : ~0ULL;
+        };
+
+        // --- Pawns ---
+        // Targets are computed for all pawns at once with one shift per direction,
+        // then turned into moves by walking back to the origin square
         {
-            u64 bishops = pos.pieces[(u8)us][(u8)PieceType::BISHOP];
-            while (bishops)
+            const u64 pawns = pos.pieces[(u8)us][(u8)PieceType::PAWN];
+            const int up = (us == Color::WHITE) ? 8 : -8;
+            const u64 double_push_rank = (us == Color::WHITE) ? bitboard::RANK_1 << 16 : bitboard::RANK_1 << 40; // after the first step
+            const u64 promotion_rank = (us == Color::WHITE) ? bitboard::RANK_8 : bitboard::RANK_1;
+
+            auto shift = [](u64 bb, int delta)
             {
-                u8 from = __builtin_ctzll(bishops);
-                bishops &= bishops - 1;
+                return delta > 0 ? bb << delta : bb >> -delta;
+            };
 
-                u64 targets = diag_attacks(from, pos.all_occupancy) & ~own_occ;
+            // Adds a move for each target reached by a pawn delta squares behind it, dropping
+            // pinned pawns that would leave their pin line (and non checks for QUIET_CHECKS)
+            auto add_pawn_moves = [&](u64 targets, int delta, move::flags::flag_t flags, bool promotion, bool quiet)
+            {
                 while (targets)
                 {
                     u8 to = __builtin_ctzll(targets);
                     targets &= targets - 1;
+                    const u8 from = to - delta;
+
+                    if (!(pin_mask(from) & (1ULL << to)))
+                        continue;
+                    if (quiet && !(checking(PieceType::PAWN, from) & (1ULL << to)))
+                        continue;
 
-                    add(move::make(from, to, (enemy_occ & (1ULL << to)) ? move::flags::CAPTURE : move::flags::QUIET), PieceType::BISHOP);
+                    if (promotion)
+                    {
+                        add(move::make(from, to, move::flags::PROMO_Q | flags));
+                        add(move::make(from, to, move::flags::PROMO_R | flags));
+                        add(move::make(from, to, move::flags::PROMO_B | flags));
+                        add(move::make(from, to, move::flags::PROMO_N | flags));
+                    }
+                    else
+                        add(move::make(from, to, flags));
                 }
-            }
-        }
+            };
 
-        // --- Rooks ---
-        {
-            u64 rooks = pos.pieces[(u8)us][(u8)PieceType::ROOK];
-            while (rooks)
+            const u64 single = shift(pawns, up) & empty;
+
+            // Promotions are generated with the captures
+            if (gen_captures)
+                add_pawn_moves(single & promotion_rank & check_mask, up, move::flags::QUIET, true, false);
+
+            if (gen_quiets)
             {
-                u8 from = __builtin_ctzll(rooks);
-                rooks &= rooks - 1;
+                const u64 double_push = shift(single & double_push_rank, up) & empty;
+                add_pawn_moves(single & ~promotion_rank & check_mask, up, move::flags::QUIET, false, true);
+                add_pawn_moves(double_push & check_mask, 2 * up, move::flags::DOUBLE_PUSH, false, true);
+            }
 
-                u64 targets = ortho_attacks(from, pos.all_occupancy) & ~own_occ;
-                while (targets)
+            if constexpr (gen_captures)
+            {
+                // Towards the h file and towards the a file, pawns on the edge file can't capture off the board
+                const int up_east = up + 1, up_west = up - 1;
+                const u64 east = shift(pawns & ~bitboard::FILE_H, up_east) & enemy_occ & check_mask;
+                const u64 west = shift(pawns & ~bitboard::FILE_A, up_west) & enemy_occ & check_mask;
+
+                add_pawn_moves(east & promotion_rank, up_east, move::flags::CAPTURE, true, false);
+                add_pawn_moves(east & ~promotion_rank, up_east, move::flags::CAPTURE, false, false);
+                add_pawn_moves(west & promotion_rank, up_west, move::flags::CAPTURE, true, false);
+                add_pawn_moves(west & ~promotion_rank, up_west, move::flags::CAPTURE, false, false);
+
+                // En passant removes two pawns from the capturing rank at once, which no
+                // mask can describe, so replay the occupancy change against enemy sliders
+                if (pos.en_passant_square != -1)
                 {
-                    u8 to = __builtin_ctzll(targets);
-                    targets &= targets - 1;
-
-                    add(move::make(from, to, (enemy_occ & (1ULL << to)) ? move::flags::CAPTURE : move::flags::QUIET), PieceType::ROOK);
+                    const u8 ep_to = pos.en_passant_square;
+                    const u8 captured_sq = ep_to - up;
+                    u64 capturers = pawn_attacks[(u8)them][ep_to] & pawns;
+                    while (capturers)
+                    {
+                        u8 from = __builtin_ctzll(capturers);
+                        capturers &= capturers - 1;
+
+                        u64 occ = (pos.all_occupancy ^ (1ULL << from) ^ (1ULL << captured_sq)) | (1ULL << ep_to);
+                        u64 remaining_diag = their_diag & ~(1ULL << captured_sq);
+                        u64 remaining_ortho = their_ortho & ~(1ULL << captured_sq);
+                        if (!(diag_attacks(king_sq, occ) & remaining_diag) && !(ortho_attacks(king_sq, occ) & remaining_ortho) &&
+                            (!checkers || (checkers & (1ULL << captured_sq)) || (check_mask & (1ULL << ep_to))))
+                            add(move::make(from, ep_to, move::flags::EN_PASSANT | move::flags::CAPTURE));
+                    }
                 }
             }
         }
 
-        // --- Queens ---
+        // --- Knights, bishops, rooks, queens ---
+        for (u8 pt = (u8)PieceType::KNIGHT; pt <= (u8)PieceType::QUEEN; ++pt)
         {
-            u64 queens = pos.pieces[(u8)us][(u8)PieceType::QUEEN];
-            while (queens)
+            u64 pieces = pos.pieces[(u8)us][pt];
+            if (pt == (u8)PieceType::KNIGHT)
+                pieces &= ~pinned; // a pinned knight can never stay on its pin line
+
+            while (pieces)
             {
-                u8 from = __builtin_ctzll(queens);
-                queens &= queens - 1;
+                u8 from = __builtin_ctzll(pieces);
+                pieces &= pieces - 1;
 
-                u64 targets = (diag_attacks(from, pos.all_occupancy) | ortho_attacks(from, pos.all_occupancy)) & ~own_occ;
+                u64 attacks = 0;
+                switch ((PieceType)pt)
+                {
+                case PieceType::KNIGHT:
+                    attacks = knight_attacks[from];
+                    break;
+                case PieceType::BISHOP:
+                    attacks = diag_attacks(from, pos.all_occupancy);
+                    break;
+                case PieceType::ROOK:
+                    attacks = ortho_attacks(from, pos.all_occupancy);
+                    break;
+                default:
+                    attacks = diag_attacks(from, pos.all_occupancy) | ortho_attacks(from, pos.all_occupancy);
+                    break;
+                }
+
+                u64 targets = attacks & (capture_targets | (quiet_targets & checking((PieceType)pt, from))) & check_mask & pin_mask(from);
                 while (targets)
                 {
                     u8 to = __builtin_ctzll(targets);
                     targets &= targets - 1;
 
-                    add(move::make(from, to, (enemy_occ & (1ULL << to)) ? move::flags::CAPTURE : move::flags::QUIET), PieceType::QUEEN);
+                    add(move::make(from, to, capture_flag(to)));
                 }
             }
         }
 
-        // --- King ---
+        // --- Castling ---
+        if (gen_quiets && Type != GenType::EVASIONS && !checkers)
         {
-            u64 kings = pos.pieces[(u8)us][(u8)PieceType::KING];
-            assert(__builtin_popcountll(kings) == 1);
-            u8 from = __builtin_ctzll(kings);
-
-            u64 targets = king_attacks[from] & ~own_occ;
-            while (targets)
-            {
-                u8 to = __builtin_ctzll(targets);
-                targets &= targets - 1;
-
-                add(move::make(from, to, (enemy_occ & (1ULL << to)) ? move::flags::CAPTURE : move::flags::QUIET), PieceType::KING);
-            }
-
-            // --- Castling ---
             bool kc = (us == Color::WHITE) ? (pos.castling_rights & castle_rights::WK) : (pos.castling_rights & castle_rights::BK);
             bool qc = (us == Color::WHITE) ? (pos.castling_rights & castle_rights::WQ) : (pos.castling_rights & castle_rights::BQ);
 
+            // From the standard start squares, castling can only give check with the rook
+            auto castle_checks = [&](u8 king_to, u8 rook_from, u8 rook_to)
+            {
+                if constexpr (Type != GenType::QUIET_CHECKS)
+                    return true;
+                u64 occ = (pos.all_occupancy ^ (1ULL << king_sq) ^ (1ULL << rook_from)) | (1ULL << king_to) | (1ULL << rook_to);
+                return (ortho_attacks(rook_to, occ) & (1ULL << their_king_sq)) != 0;
+            };
+
             if (kc)
             {
                 // Squares between king and rook must be empty
-                if (!(pos.all_occupancy & ((1ULL << (from + 1)) | (1ULL << (from + 2))))
+                if (!(pos.all_occupancy & bitboard::between[king_sq][king_sq + 3])
                     // and squares king moves across must not be attacked
-                    && !(pos.attacked_squares(them, (1ULL << (from)) | (1ULL << (from + 1)) | (1ULL << (from + 2)))))
+                    && !(pos.attacked_squares(us, (1ULL << (king_sq + 1)) | (1ULL << (king_sq + 2))))
+                    && castle_checks(king_sq + 2, king_sq + 3, king_sq + 1))
                 {
-                    add(move::make(from, from + 2, move::flags::KING_CASTLE), PieceType::KING);
+                    add(move::make(king_sq, king_sq + 2, move::flags::KING_CASTLE));
                 }
             }
 
             if (qc)
             {
                 // Squares between king and rook must be empty
-                if (!(pos.all_occupancy & ((1ULL << (from - 1)) | (1ULL << (from - 2)) | (1ULL << (from - 3))))
+                if (!(pos.all_occupancy & bitboard::between[king_sq][king_sq - 4])
                     // and squares king moves across must not be attacked
-                    && !(pos.attacked_squares(them, (1ULL << (from)) | (1ULL << (from - 1)) | (1ULL << (from - 2)))))
+                    && !(pos.attacked_squares(us, (1ULL << (king_sq - 1)) | (1ULL << (king_sq - 2))))
+                    && castle_checks(king_sq - 2, king_sq - 4, king_sq - 1))
                 {
-                    add(move::make(from, from - 2, move::flags::QUEEN_CASTLE), PieceType::KING);
+                    add(move::make(king_sq, king_sq - 2, move::flags::QUEEN_CASTLE));
                 }
             }
         }
@@ -459,6 +732,17 @@ namespace chess
         return move_count;
     }
 
+    template std::size_t generate<GenType::CAPTURES>(const Position &, Move *);
+    template std::size_t generate<GenType::QUIETS>(const Position &, Move *);
+    template std::size_t generate<GenType::EVASIONS>(const Position &, Move *);
+    template std::size_t generate<GenType::QUIET_CHECKS>(const Position &, Move *);
+    template std::size_t generate<GenType::ALL>(const Position &, Move *);
+
+    std::size_t get_moves(const Position &pos, Move *moves)
+    {
+        return generate<GenType::ALL>(pos, moves);
+    }
+
     std::string Position::algebraic_notation(const Move &m) const
     {
         if (move::is_castle_kingside(m))
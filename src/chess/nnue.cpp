@@ -0,0 +1,227 @@
+#include "chess/nnue.hpp"
+#include "chess/cpu.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#ifdef CHESS_X86
+#include <immintrin.h>
+#endif
+
+namespace chess
+{
+    namespace nnue
+    {
+        namespace detail
+        {
+            bool enabled = false;
+        } // namespace detail
+
+        struct Network
+        {
+            alignas(32) i16 feature_weights[INPUTS][HIDDEN];
+            alignas(32) i16 feature_bias[HIDDEN];
+            alignas(32) i16 output_weights[2 * HIDDEN];
+            i16 output_bias;
+        };
+
+        static std::unique_ptr<Network> network;
+
+        // --- Kernels, HIDDEN is a multiple of every vector width ---
+
+        static_assert(HIDDEN % 16 == 0, "hidden layer must fill whole AVX2 registers");
+
+        static void add_row_scalar(i16 *acc, const i16 *row)
+        {
+            for (int i = 0; i < HIDDEN; ++i)
+                acc[i] += row[i];
+        }
+
+        static void sub_row_scalar(i16 *acc, const i16 *row)
+        {
+            for (int i = 0; i < HIDDEN; ++i)
+                acc[i] -= row[i];
+        }
+
+        static i32 dot_crelu_scalar(const i16 *acc, const i16 *weights)
+        {
+            i32 sum = 0;
+            for (int i = 0; i < HIDDEN; ++i)
+            {
+                const i32 v = acc[i] < 0 ? 0 : (acc[i] > QA ? QA : acc[i]);
+                sum += v * weights[i];
+            }
+            return sum;
+        }
+
+#ifdef CHESS_X86
+        __attribute__((target("sse4.1"))) static void add_row_sse41(i16 *acc, const i16 *row)
+        {
+            for (int i = 0; i < HIDDEN; i += 8)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *)(acc + i));
+                _mm_storeu_si128((__m128i *)(acc + i), _mm_add_epi16(a, _mm_loadu_si128((const __m128i *)(row + i))));
+            }
+        }
+
+        __attribute__((target("sse4.1"))) static void sub_row_sse41(i16 *acc, const i16 *row)
+        {
+            for (int i = 0; i < HIDDEN; i += 8)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *)(acc + i));
+                _mm_storeu_si128((__m128i *)(acc + i), _mm_sub_epi16(a, _mm_loadu_si128((const __m128i *)(row + i))));
+            }
+        }
+
+        __attribute__((target("sse4.1"))) static i32 dot_crelu_sse41(const i16 *acc, const i16 *weights)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i qa = _mm_set1_epi16(QA);
+            __m128i sum = zero;
+            for (int i = 0; i < HIDDEN; i += 8)
+            {
+                __m128i v = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i *)(acc + i)), zero), qa);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(v, _mm_loadu_si128((const __m128i *)(weights + i))));
+            }
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+            return _mm_cvtsi128_si32(sum);
+        }
+
+        __attribute__((target("avx2"))) static void add_row_avx2(i16 *acc, const i16 *row)
+        {
+            for (int i = 0; i < HIDDEN; i += 16)
+            {
+                __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+                _mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi16(a, _mm256_loadu_si256((const __m256i *)(row + i))));
+            }
+        }
+
+        __attribute__((target("avx2"))) static void sub_row_avx2(i16 *acc, const i16 *row)
+        {
+            for (int i = 0; i < HIDDEN; i += 16)
+            {
+                __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+                _mm256_storeu_si256((__m256i *)(acc + i), _mm256_sub_epi16(a, _mm256_loadu_si256((const __m256i *)(row + i))));
+            }
+        }
+
+        __attribute__((target("avx2"))) static i32 dot_crelu_avx2(const i16 *acc, const i16 *weights)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i qa = _mm256_set1_epi16(QA);
+            __m256i sum = zero;
+            for (int i = 0; i < HIDDEN; i += 16)
+            {
+                __m256i v = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *)(acc + i)), zero), qa);
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, _mm256_loadu_si256((const __m256i *)(weights + i))));
+            }
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+            return _mm_cvtsi128_si32(s);
+        }
+#endif
+
+        struct Kernels
+        {
+            void (*add_row)(i16 *acc, const i16 *row);
+            void (*sub_row)(i16 *acc, const i16 *row);
+            i32 (*dot_crelu)(const i16 *acc, const i16 *weights);
+            const char *name;
+        };
+
+        static const Kernels kernels = cpu::select<Kernels>({
+#ifdef CHESS_X86
+            {cpu::feature::AVX2, {add_row_avx2, sub_row_avx2, dot_crelu_avx2, "avx2"}},
+            {cpu::feature::SSE41, {add_row_sse41, sub_row_sse41, dot_crelu_sse41, "sse4.1"}},
+#endif
+            {0, {add_row_scalar, sub_row_scalar, dot_crelu_scalar, "scalar"}},
+        });
+
+        // Input index of a piece as seen from perspective
+        static inline int feature_index(u8 perspective, u8 color, u8 piece_type, u8 square)
+        {
+            const int relative_square = perspective == 0 ? square : square ^ 56;
+            return (color == perspective ? 0 : 384) + piece_type * 64 + relative_square;
+        }
+
+        void detail::update(Accumulator &acc, u8 color, u8 piece_type, u8 square, bool add)
+        {
+            for (u8 p = 0; p < 2; ++p)
+            {
+                const i16 *row = network->feature_weights[feature_index(p, color, piece_type, square)];
+                if (add)
+                    kernels.add_row(acc.values[p], row);
+                else
+                    kernels.sub_row(acc.values[p], row);
+            }
+        }
+
+        void load(const std::string &path)
+        {
+            std::ifstream in(path, std::ios::binary);
+            if (!in)
+                throw std::runtime_error("can't open network file " + path);
+
+            char magic[4];
+            u32 hidden = 0;
+            in.read(magic, sizeof(magic));
+            in.read(reinterpret_cast<char *>(&hidden), sizeof(hidden));
+            if (!in || std::memcmp(magic, "CNUE", 4) != 0)
+                throw std::runtime_error("not a network file: " + path);
+            if (hidden != HIDDEN)
+                throw std::runtime_error("network has " + std::to_string(hidden) + " hidden neurons, expected " + std::to_string(HIDDEN));
+
+            auto net = std::make_unique<Network>();
+            in.read(reinterpret_cast<char *>(net->feature_weights), sizeof(net->feature_weights));
+            in.read(reinterpret_cast<char *>(net->feature_bias), sizeof(net->feature_bias));
+            in.read(reinterpret_cast<char *>(net->output_weights), sizeof(net->output_weights));
+            in.read(reinterpret_cast<char *>(&net->output_bias), sizeof(net->output_bias));
+            if (!in || in.peek() != std::ifstream::traits_type::eof())
+                throw std::runtime_error("network file has the wrong size: " + path);
+
+            network = std::move(net);
+        }
+
+        bool loaded()
+        {
+            return network != nullptr;
+        }
+
+        void set_enabled(bool enabled)
+        {
+            detail::enabled = enabled && loaded();
+        }
+
+        const char *simd_name()
+        {
+            return kernels.name;
+        }
+
+        void refresh(Accumulator &acc, const u64 (&pieces)[2][6])
+        {
+            for (u8 p = 0; p < 2; ++p)
+                std::memcpy(acc.values[p], network->feature_bias, sizeof(network->feature_bias));
+
+            for (u8 color = 0; color < 2; ++color)
+            {
+                for (u8 pt = 0; pt < 6; ++pt)
+                {
+                    for (u64 bb = pieces[color][pt]; bb; bb &= bb - 1)
+                        detail::update(acc, color, pt, __builtin_ctzll(bb), true);
+                }
+            }
+        }
+
+        int evaluate(const Accumulator &acc, u8 side_to_move)
+        {
+            i32 output = network->output_bias;
+            output += kernels.dot_crelu(acc.values[side_to_move], network->output_weights);
+            output += kernels.dot_crelu(acc.values[side_to_move ^ 1], network->output_weights + HIDDEN);
+            return (int)((i64)output * SCALE / (QA * QB));
+        }
+    } // namespace nnue
+} // namespace chess
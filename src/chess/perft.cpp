@@ -0,0 +1,137 @@
+#include "chess/perft.hpp"
+
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "chess/hashtable.hpp"
+
+namespace chess
+{
+    namespace
+    {
+        // (hash, depth) -> nodes cache shared between the perft threads
+        class PerftTable
+        {
+        public:
+            explicit PerftTable(std::size_t mb)
+            {
+                const std::size_t count = hash_table_slots(mb, sizeof(HashEntry));
+                entries.reset(new HashEntry[count]);
+                std::memset(static_cast<void *>(entries.get()), 0, count * sizeof(HashEntry));
+                mask = count - 1;
+            }
+
+            bool probe(u64 key, int depth, u64 &nodes) const
+            {
+                u64 data;
+                if (!entries[index(key, depth)].probe(key, data) || (data & 0xFF) != (u64)depth)
+                    return false;
+
+                nodes = data >> 8;
+                return true;
+            }
+
+            void store(u64 key, int depth, u64 nodes)
+            {
+                entries[index(key, depth)].store(key, (nodes << 8) | (u64)depth);
+            }
+
+        private:
+            // data: [0, 8) depth | [8, 64) nodes
+            std::size_t index(u64 key, int depth) const
+            {
+                return (key ^ (depth * 0x9E3779B97F4A7C15ULL)) & mask;
+            }
+
+            std::unique_ptr<HashEntry[]> entries;
+            std::size_t mask = 0;
+        };
+
+        u64 perft_hashed(Position &pos, int depth, PerftTable *table)
+        {
+            // Probe before generating, so a hit costs no move generation
+            u64 nodes = 0;
+            if (depth > 1 && table && table->probe(pos.hash(), depth, nodes))
+                return nodes;
+
+            Move moves[256];
+            size_t move_count = get_moves(pos, moves);
+
+            // The generator is fully legal, so the last ply doesn't need to be played out
+            if (depth == 1)
+                return move_count;
+
+            for (size_t i = 0; i < move_count; ++i)
+            {
+                UndoState undo;
+                pos.make_move(moves[i], undo);
+                nodes += perft_hashed(pos, depth - 1, table);
+                pos.undo_move(undo);
+            }
+
+            if (table)
+                table->store(pos.hash(), depth, nodes);
+
+            return nodes;
+        }
+    } // namespace
+
+    u64 perft(Position &pos, int depth)
+    {
+        if (depth == 0)
+            return 1;
+
+        return perft_hashed(pos, depth, nullptr);
+    }
+
+    PerftResult perft_divide(const Position &pos, int depth, int threads, std::size_t hash_mb)
+    {
+        PerftResult result;
+        if (depth <= 0)
+        {
+            result.nodes = 1;
+            return result;
+        }
+
+        Move moves[256];
+        std::size_t move_count = get_moves(pos, moves);
+
+        result.divide.resize(move_count);
+        for (std::size_t i = 0; i < move_count; ++i)
+            result.divide[i] = {moves[i], 1};
+
+        std::unique_ptr<PerftTable> table;
+        if (hash_mb > 0 && depth > 2)
+            table = std::make_unique<PerftTable>(hash_mb);
+
+        // Workers pull root moves off a shared counter until all are counted
+        std::atomic<std::size_t> next{0};
+        auto worker = [&]()
+        {
+            Position local = pos;
+            std::size_t i;
+            while ((i = next.fetch_add(1)) < move_count && depth > 1)
+            {
+                UndoState undo;
+                local.make_move(moves[i], undo);
+                result.divide[i].second = perft_hashed(local, depth - 1, table.get());
+                local.undo_move(undo);
+            }
+        };
+
+        if (threads < 1)
+            threads = 1;
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads && (std::size_t)t < move_count; ++t)
+            pool.emplace_back(worker);
+        worker();
+        for (std::thread &t : pool)
+            t.join();
+
+        for (const auto &[m, nodes] : result.divide)
+            result.nodes += nodes;
+
+        return result;
+    }
+} // namespace chess
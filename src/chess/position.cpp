@@ -99,6 +99,11 @@ namespace chess
         halfmove_clock = halfmove;
 
         compute_occupancy();
+        key = compute_hash();
+        pawn_key = compute_pawn_hash();
+        psq = compute_psq();
+        phase = compute_phase();
+        refresh_accumulator();
     }
 
     std::string Position::to_fen() const
@@ -185,7 +190,7 @@ namespace chess
         }
     }
 
-    u64 Position::hash() const
+    u64 Position::compute_hash() const
     {
         u64 h = 0;
 
@@ -221,6 +226,56 @@ namespace chess
         return h;
     }
 
+    u64 Position::compute_pawn_hash() const
+    {
+        u64 h = 0;
+        for (int color = 0; color < 2; ++color)
+        {
+            u64 bb = pieces[color][(int)PieceType::PAWN];
+            while (bb)
+            {
+                h ^= zobrist::pieces[color][(int)PieceType::PAWN][__builtin_ctzll(bb)];
+                bb &= bb - 1;
+            }
+        }
+        return h;
+    }
+
+    psqt::Score Position::compute_psq() const
+    {
+        psqt::Score s;
+        for (u8 color = 0; color < 2; ++color)
+        {
+            for (u8 pt = 0; pt < 6; ++pt)
+            {
+                u64 bb = pieces[color][pt];
+                while (bb)
+                {
+                    s += psqt::piece_square(color, pt, __builtin_ctzll(bb));
+                    bb &= bb - 1;
+                }
+            }
+        }
+        return s;
+    }
+
+    u8 Position::compute_phase() const
+    {
+        int p = 0;
+        for (int color = 0; color < 2; ++color)
+        {
+            for (int pt = 0; pt < 6; ++pt)
+                p += __builtin_popcountll(pieces[color][pt]) * psqt::phase_weights[pt];
+        }
+        return (u8)p;
+    }
+
+    void Position::refresh_accumulator()
+    {
+        if (nnue::enabled())
+            nnue::refresh(accumulator, pieces);
+    }
+
     void Position::make_move(const Move &m)
     {
         Color us = turn();              // side to move
@@ -228,6 +283,11 @@ namespace chess
         u8 from = move::from(m);
         u8 to = move::to(m);
 
+        // Castling and en passant keys are re-added once the new state is known
+        key ^= zobrist::castling[castling_rights];
+        if (en_passant_square != -1)
+            key ^= zobrist::ep[en_passant_square % 8];
+
         // Find the moving piece type
         PieceType moving_type = PieceType::PAWN;
         for (int pt = 0; pt < 6; ++pt)
@@ -236,6 +296,11 @@ namespace chess
             {
                 moving_type = (PieceType)pt;
                 pieces[(u8)us][pt] ^= (1ULL << from); // Remove from 'from'
+                key ^= zobrist::pieces[(u8)us][pt][from];
+                psq -= psqt::piece_square((u8)us, pt, from);
+                nnue::remove_piece(accumulator, (u8)us, pt, from);
+                if (moving_type == PieceType::PAWN)
+                    pawn_key ^= zobrist::pieces[(u8)us][pt][from];
                 break;
             }
         }
@@ -244,26 +309,32 @@ namespace chess
         if (move::is_castle_kingside(m))
         {
             pieces[(u8)us][(u8)PieceType::KING] |= (1ULL << to);
-            if (us == Color::WHITE)
-            {
-                pieces[(u8)us][(u8)PieceType::ROOK] ^= (1ULL << 7) | (1ULL << 5);
-            }
-            else
-            {
-                pieces[(u8)us][(u8)PieceType::ROOK] ^= (1ULL << 63) | (1ULL << 61);
-            }
+            key ^= zobrist::pieces[(u8)us][(u8)PieceType::KING][to];
+            psq += psqt::piece_square((u8)us, (u8)PieceType::KING, to);
+            nnue::add_piece(accumulator, (u8)us, (u8)PieceType::KING, to);
+            const u8 rook_from = (us == Color::WHITE) ? 7 : 63;
+            const u8 rook_to = (us == Color::WHITE) ? 5 : 61;
+            pieces[(u8)us][(u8)PieceType::ROOK] ^= (1ULL << rook_from) | (1ULL << rook_to);
+            key ^= zobrist::pieces[(u8)us][(u8)PieceType::ROOK][rook_from] ^ zobrist::pieces[(u8)us][(u8)PieceType::ROOK][rook_to];
+            psq -= psqt::piece_square((u8)us, (u8)PieceType::ROOK, rook_from);
+            psq += psqt::piece_square((u8)us, (u8)PieceType::ROOK, rook_to);
+            nnue::remove_piece(accumulator, (u8)us, (u8)PieceType::ROOK, rook_from);
+            nnue::add_piece(accumulator, (u8)us, (u8)PieceType::ROOK, rook_to);
         }
         else if (move::is_castle_queenside(m))
         {
             pieces[(u8)us][(u8)PieceType::KING] |= (1ULL << to);
-            if (us == Color::WHITE)
-            {
-                pieces[(u8)us][(u8)PieceType::ROOK] ^= (1ULL << 0) | (1ULL << 3);
-            }
-            else
-            {
-                pieces[(u8)us][(u8)PieceType::ROOK] ^= (1ULL << 56) | (1ULL << 59);
-            }
+            key ^= zobrist::pieces[(u8)us][(u8)PieceType::KING][to];
+            psq += psqt::piece_square((u8)us, (u8)PieceType::KING, to);
+            nnue::add_piece(accumulator, (u8)us, (u8)PieceType::KING, to);
+            const u8 rook_from = (us == Color::WHITE) ? 0 : 56;
+            const u8 rook_to = (us == Color::WHITE) ? 3 : 59;
+            pieces[(u8)us][(u8)PieceType::ROOK] ^= (1ULL << rook_from) | (1ULL << rook_to);
+            key ^= zobrist::pieces[(u8)us][(u8)PieceType::ROOK][rook_from] ^ zobrist::pieces[(u8)us][(u8)PieceType::ROOK][rook_to];
+            psq -= psqt::piece_square((u8)us, (u8)PieceType::ROOK, rook_from);
+            psq += psqt::piece_square((u8)us, (u8)PieceType::ROOK, rook_to);
+            nnue::remove_piece(accumulator, (u8)us, (u8)PieceType::ROOK, rook_from);
+            nnue::add_piece(accumulator, (u8)us, (u8)PieceType::ROOK, rook_to);
         }
         else
         {
@@ -272,29 +343,38 @@ namespace chess
             {
                 PieceType promoted_type = (PieceType)move::promo_piece_index(m);
                 pieces[(u8)us][(u8)promoted_type] |= (1ULL << to);
+                key ^= zobrist::pieces[(u8)us][(u8)promoted_type][to];
+                psq += psqt::piece_square((u8)us, (u8)promoted_type, to);
+                phase += psqt::phase_weights[(u8)promoted_type];
+                nnue::add_piece(accumulator, (u8)us, (u8)promoted_type, to);
             }
             else
             {
                 // Normal move
                 pieces[(u8)us][(u8)moving_type] |= (1ULL << to);
+                key ^= zobrist::pieces[(u8)us][(u8)moving_type][to];
+                psq += psqt::piece_square((u8)us, (u8)moving_type, to);
+                nnue::add_piece(accumulator, (u8)us, (u8)moving_type, to);
+                if (moving_type == PieceType::PAWN)
+                    pawn_key ^= zobrist::pieces[(u8)us][(u8)moving_type][to];
             }
 
             // Handle captures
             if (move::is_capture(m))
             {
-                if (move::is_en_passant(m))
-                {
-                    int ep_square = to + ((us == Color::WHITE) ? -8 : 8);
-                    for (int pt = 0; pt < 6; ++pt)
-                    {
-                        pieces[(u8)them][pt] &= ~(1ULL << ep_square);
-                    }
-                }
-                else
+                int cap_square = move::is_en_passant(m) ? to + ((us == Color::WHITE) ? -8 : 8) : to;
+                for (int pt = 0; pt < 6; ++pt)
                 {
-                    for (int pt = 0; pt < 6; ++pt)
+                    if (pieces[(u8)them][pt] & (1ULL << cap_square))
                     {
-                        pieces[(u8)them][pt] &= ~(1ULL << to);
+                        pieces[(u8)them][pt] &= ~(1ULL << cap_square);
+                        key ^= zobrist::pieces[(u8)them][pt][cap_square];
+                        psq -= psqt::piece_square((u8)them, pt, cap_square);
+                        phase -= psqt::phase_weights[pt];
+                        nnue::remove_piece(accumulator, (u8)them, pt, cap_square);
+                        if (pt == (int)PieceType::PAWN)
+                            pawn_key ^= zobrist::pieces[(u8)them][pt][cap_square];
+                        break;
                     }
                 }
             }
@@ -364,7 +444,21 @@ namespace chess
         // Next ply
         ply += 1;
 
+        key ^= zobrist::castling[castling_rights];
+        if (en_passant_square != -1)
+            key ^= zobrist::ep[en_passant_square % 8];
+        key ^= zobrist::turn;
+
         compute_occupancy();
+        assert(key == compute_hash() && pawn_key == compute_pawn_hash());
+        assert(psq == compute_psq() && phase == compute_phase());
+#ifdef CHESS_PARANOID
+        if (!validate_state())
+        {
+            std::cerr << "Invalid position after make_move " << move::to_string(m) << ": \"" << to_fen() << "\"" << std::endl;
+            std::abort();
+        }
+#endif
     }
 
     void Position::make_move(const Move &m, UndoState &undo)
@@ -373,6 +467,10 @@ namespace chess
         undo.castling_rights = castling_rights;
         undo.en_passant_square = en_passant_square;
         undo.halfmove_clock = halfmove_clock;
+        undo.key = key;
+        undo.pawn_key = pawn_key;
+        undo.psq = psq;
+        undo.phase = phase;
 
         // Find moved piece type
         undo.moved_type = PieceType::PAWN; // default
@@ -421,25 +519,27 @@ namespace chess
         halfmove_clock = undo.halfmove_clock;
         castling_rights = undo.castling_rights;
         en_passant_square = undo.en_passant_square;
+        key = undo.key;
+        pawn_key = undo.pawn_key;
+        psq = undo.psq;
+        phase = undo.phase;
 
         u8 from = move::from(m);
         u8 to = move::to(m);
 
-        if (move::is_castle_kingside(m))
-        {
-            pieces[us][(u8)PieceType::KING] ^= (1ULL << from) | (1ULL << to);
-            if ((Color)us == Color::WHITE)
-                pieces[us][(u8)PieceType::ROOK] ^= (1ULL << 5) | (1ULL << 7);
-            else
-                pieces[us][(u8)PieceType::ROOK] ^= (1ULL << 61) | (1ULL << 63);
-        }
-        else if (move::is_castle_queenside(m))
+        // The network accumulator is the only state not saved in undo, its updates are reversed
+        if (move::is_castle_kingside(m) || move::is_castle_queenside(m))
         {
+            const bool kingside = move::is_castle_kingside(m);
+            const u8 rook_from = ((Color)us == Color::WHITE) ? (kingside ? 7 : 0) : (kingside ? 63 : 56);
+            const u8 rook_to = ((Color)us == Color::WHITE) ? (kingside ? 5 : 3) : (kingside ? 61 : 59);
+
             pieces[us][(u8)PieceType::KING] ^= (1ULL << from) | (1ULL << to);
-            if ((Color)us == Color::WHITE)
-                pieces[us][(u8)PieceType::ROOK] ^= (1ULL << 3) | (1ULL << 0);
-            else
-                pieces[us][(u8)PieceType::ROOK] ^= (1ULL << 59) | (1ULL << 56);
+            pieces[us][(u8)PieceType::ROOK] ^= (1ULL << rook_from) | (1ULL << rook_to);
+            nnue::remove_piece(accumulator, us, (u8)PieceType::KING, to);
+            nnue::add_piece(accumulator, us, (u8)PieceType::KING, from);
+            nnue::remove_piece(accumulator, us, (u8)PieceType::ROOK, rook_to);
+            nnue::add_piece(accumulator, us, (u8)PieceType::ROOK, rook_from);
         }
 
         else
@@ -448,29 +548,62 @@ namespace chess
             {
                 pieces[us][(u8)move::promo_piece_index(m)] ^= (1ULL << to);
                 pieces[us][(u8)PieceType::PAWN] |= (1ULL << from);
+                nnue::remove_piece(accumulator, us, (u8)move::promo_piece_index(m), to);
+                nnue::add_piece(accumulator, us, (u8)PieceType::PAWN, from);
             }
             else
             {
                 pieces[us][(u8)undo.moved_type] ^= (1ULL << to);
                 pieces[us][(u8)undo.moved_type] |= (1ULL << from);
+                nnue::remove_piece(accumulator, us, (u8)undo.moved_type, to);
+                nnue::add_piece(accumulator, us, (u8)undo.moved_type, from);
             }
 
             if (move::is_capture(m))
             {
-                if (move::is_en_passant(m))
-                {
-                    int dir = ((Color)us == Color::WHITE) ? -8 : 8;
-                    int ep_square = to + dir;
-                    pieces[them][(u8)undo.captured_type] |= (1ULL << ep_square);
-                }
-                else
-                {
-                    pieces[them][(u8)undo.captured_type] |= (1ULL << to);
-                }
+                const u8 cap_square = move::is_en_passant(m) ? to + (((Color)us == Color::WHITE) ? -8 : 8) : to;
+                pieces[them][(u8)undo.captured_type] |= (1ULL << cap_square);
+                nnue::add_piece(accumulator, them, (u8)undo.captured_type, cap_square);
             }
         }
 
         compute_occupancy();
+        assert(key == compute_hash() && pawn_key == compute_pawn_hash());
+        assert(psq == compute_psq() && phase == compute_phase());
+#ifdef CHESS_PARANOID
+        if (!validate_state())
+        {
+            std::cerr << "Invalid position after undo_move " << move::to_string(m) << ": \"" << to_fen() << "\"" << std::endl;
+            std::abort();
+        }
+#endif
+    }
+
+    void Position::make_null_move(UndoState &undo)
+    {
+        undo.move = 0;
+        undo.castling_rights = castling_rights;
+        undo.en_passant_square = en_passant_square;
+        undo.halfmove_clock = halfmove_clock;
+        undo.key = key;
+
+        if (en_passant_square != -1)
+            key ^= zobrist::ep[en_passant_square % 8];
+        key ^= zobrist::turn;
+
+        en_passant_square = -1;
+        halfmove_clock++;
+        ply += 1;
+
+        assert(key == compute_hash());
+    }
+
+    void Position::undo_null_move(const UndoState &undo)
+    {
+        ply -= 1;
+        halfmove_clock = undo.halfmove_clock;
+        en_passant_square = undo.en_passant_square;
+        key = undo.key;
     }
 
     bool Position::validate_occupancy() const
@@ -533,4 +666,75 @@ namespace chess
 
         return true;
     }
+
+    bool Position::validate_state() const
+    {
+        if (!validate_occupancy())
+            return false;
+
+        if (key != compute_hash() || pawn_key != compute_pawn_hash())
+        {
+            std::cerr << "Zobrist key mismatch" << std::endl;
+            return false;
+        }
+
+        if (psq != compute_psq() || phase != compute_phase())
+        {
+            std::cerr << "Evaluation terms mismatch" << std::endl;
+            return false;
+        }
+
+        if (nnue::enabled())
+        {
+            Position fresh = *this;
+            fresh.refresh_accumulator();
+            if (std::memcmp(&fresh.accumulator, &accumulator, sizeof(accumulator)) != 0)
+            {
+                std::cerr << "Network accumulator mismatch" << std::endl;
+                return false;
+            }
+        }
+
+        // No pawns on the back ranks
+        if ((pieces[0][(int)PieceType::PAWN] | pieces[1][(int)PieceType::PAWN]) & 0xFF000000000000FFULL)
+        {
+            std::cerr << "Pawn on first or last rank" << std::endl;
+            return false;
+        }
+
+        // Castling rights need the king and rook on their starting squares
+        const u64 wk = pieces[0][(int)PieceType::KING], bk = pieces[1][(int)PieceType::KING];
+        const u64 wr = pieces[0][(int)PieceType::ROOK], br = pieces[1][(int)PieceType::ROOK];
+        if (((castling_rights & castle_rights::WK) && !((wk & (1ULL << 4)) && (wr & (1ULL << 7)))) ||
+            ((castling_rights & castle_rights::WQ) && !((wk & (1ULL << 4)) && (wr & (1ULL << 0)))) ||
+            ((castling_rights & castle_rights::BK) && !((bk & (1ULL << 60)) && (br & (1ULL << 63)))) ||
+            ((castling_rights & castle_rights::BQ) && !((bk & (1ULL << 60)) && (br & (1ULL << 56)))))
+        {
+            std::cerr << "Castling rights without king/rook on home squares" << std::endl;
+            return false;
+        }
+
+        // En passant square must be empty, on the right rank, with the double-pushed pawn in front of it
+        if (en_passant_square != -1)
+        {
+            const bool white_to_move = turn() == Color::WHITE;
+            const int rank = en_passant_square / 8;
+            const int pawn_sq = en_passant_square + (white_to_move ? -8 : 8);
+            if (rank != (white_to_move ? 5 : 2) || is_occupied(en_passant_square) ||
+                !is_occupied(white_to_move ? Color::BLACK : Color::WHITE, PieceType::PAWN, pawn_sq))
+            {
+                std::cerr << "Invalid en passant square" << std::endl;
+                return false;
+            }
+        }
+
+        // The side that just moved can't have left its king in check
+        if (king_checked(Color(1 ^ (u8)turn())))
+        {
+            std::cerr << "Side not to move is in check" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
 }
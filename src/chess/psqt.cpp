@@ -0,0 +1,32 @@
+#include "chess/psqt.hpp"
+
+#include "pst.hpp"
+
+namespace chess
+{
+    namespace psqt
+    {
+        static constexpr Table build_table()
+        {
+            Table t{};
+            for (int c = 0; c < 2; ++c)
+            {
+                const Color color = static_cast<Color>(c);
+                const int sign = (color == Color::WHITE) ? 1 : -1;
+
+                for (int pt = 0; pt < 6; ++pt)
+                {
+                    for (u8 sq = 0; sq < 64; ++sq)
+                    {
+                        t.scores[c][pt][sq].mg = sign * (piece_values[pt] + PST[MIDGAME][pt][mirror_square(color, sq)]);
+                        t.scores[c][pt][sq].eg = sign * (piece_values[pt] + PST[ENDGAME][pt][mirror_square(color, sq)]);
+                    }
+                }
+            }
+            return t;
+        }
+
+        // Constant initialized, positions built during static initialization can already use it
+        constexpr Table table = build_table();
+    } // namespace psqt
+} // namespace chess
@@ -1,9 +1,8 @@
 #pragma once
 
-#include <cstdint>
 #include "chess/position.hpp"
 
-namespace chess::engine
+namespace chess::psqt
 {
     enum Phase
     {
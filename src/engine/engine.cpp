@@ -1,8 +1,17 @@
 #include "engine/engine.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
 
 #include "eval.hpp"
+#include "history.hpp"
+#include "movepick.hpp"
+#include "pawns.hpp"
+#include "tt.hpp"
 
 namespace chess
 {
@@ -11,122 +20,823 @@ namespace chess
         static constexpr int MATE_SCORE = 30000;
         static constexpr int DRAW_SCORE = 0;
         static constexpr int INF = 32000;
+        static constexpr int MATE_BOUND = MATE_SCORE - MAX_PLY; // scores beyond this are mates
 
-        static int score_move(const Position &pos, Move m)
+        // Initial half width of the root search window around the previous score, doubled on each fail
+        static constexpr int ASPIRATION_DELTA = 25;
+        static constexpr int ASPIRATION_MIN_DEPTH = 4;
+
+        static TranspositionTable tt;
+
+        // One pawn structure cache per search thread index, kept across searches so it stays warm
+        static std::vector<PawnTable> pawn_tables;
+
+        static int thread_count = 1;
+        static bool null_move_enabled = true;
+        static bool lmr_enabled = true;
+
+        using Clock = std::chrono::steady_clock;
+
+        // State shared by every thread of a single search
+        struct SharedSearch
         {
-            int score = 0;
-            const u8 from_sq = move::from(m);
-            const u8 to_sq = move::to(m);
+            SearchLimits limits;
+            bool null_move = null_move_enabled;
+            bool lmr = lmr_enabled;
+
+            Clock::time_point start;
+            i64 soft_limit_ms = 0; // don't start another iteration past this (0 = iterate until the hard limit)
+            i64 hard_limit_ms = 0; // abort the running iteration past this (0 = no limit)
+
+            // While pondering the time limits are counted from the ponderhit instead of the start
+            std::atomic<i64> clock_origin_ms{0}; // -1 until the ponderhit
+
+            std::atomic<u64> nodes{0};
+            std::atomic<bool> stop{false};
+            std::atomic<bool> can_stop{false}; // set once the main thread has a move to play
+
+            const IterationCallback &on_iteration;
+
+            SharedSearch(const SearchLimits &limits, const IterationCallback &on_iteration)
+                : limits(limits), start(Clock::now()), on_iteration(on_iteration)
+            {
+                if (limits.signals && limits.signals->ponder.load(std::memory_order_relaxed))
+                    clock_origin_ms.store(-1, std::memory_order_relaxed);
+            }
+
+            i64 elapsed_ms() const
+            {
+                return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+            }
+
+            // Time counted against the limits, -1 while pondering
+            i64 clock_ms()
+            {
+                i64 origin = clock_origin_ms.load(std::memory_order_relaxed);
+                if (origin < 0)
+                {
+                    if (limits.signals->ponder.load(std::memory_order_relaxed))
+                        return -1;
+
+                    // First thread to notice the ponderhit starts the clock
+                    const i64 now = elapsed_ms();
+                    if (clock_origin_ms.compare_exchange_strong(origin, now, std::memory_order_relaxed))
+                        origin = now;
+                }
+                return elapsed_ms() - origin;
+            }
+
+            bool stop_requested() const
+            {
+                return stop.load(std::memory_order_relaxed) ||
+                       (limits.signals && limits.signals->stop.load(std::memory_order_relaxed));
+            }
+        };
+
+        // Per thread search state, every thread owns its own copy of the game
+        struct SearchContext
+        {
+            static constexpr u64 CHECK_INTERVAL = 1024;
+
+            Game &game;
+            SharedSearch &shared;
+            int id;
+
+            SearchHistory history;
+            PawnTable &pawn_table;
+
+            // Line being searched. Moves are made on game.position directly, Game::make_move would
+            // grow Game::seen_positions by an entry per node. move_stack holds 0 for null moves.
+            UndoState undo_stack[MAX_PLY];
+            Move move_stack[MAX_PLY];
+
+            // Keys of the game's positions up to the root followed by those of the line being searched
+            std::vector<u64> keys;
+            std::size_t root_index = 0;
+
+            // Triangular PV table: pv[ply][ply, pv_length[ply]) is the best line found from ply
+            Move pv[MAX_PLY][MAX_PLY];
+            int pv_length[MAX_PLY];
 
-            // Capture bonus (MVV-LVA approximation)
-            if (move::is_capture(m))
+            // Principal variation of the last completed iteration
+            Move root_pv[MAX_PLY];
+            int root_pv_length = 0;
+
+            u64 nodes = 0;
+            int seldepth = 0;
+            int completed_depth = 0;
+            Move best_move = 0;
+            int best_score = 0;
+            bool stopped = false;
+
+            SearchContext(Game &game, SharedSearch &shared, int id)
+                : game(game), shared(shared), id(id), pawn_table(pawn_tables[id])
+            {
+                keys.reserve(game.history.size() + MAX_PLY + 1);
+                for (const UndoState &undo : game.history)
+                    keys.push_back(undo.key);
+                keys.push_back(game.position.hash());
+                root_index = keys.size() - 1;
+            }
+
+            bool is_main() const { return id == 0; }
+
+            void make_move(int ply, Move move)
+            {
+                game.position.make_move(move, undo_stack[ply]);
+                move_stack[ply] = move;
+                keys.push_back(game.position.hash());
+            }
+
+            void undo_move(int ply)
+            {
+                keys.pop_back();
+                game.position.undo_move(undo_stack[ply]);
+            }
+
+            void make_null_move(int ply)
+            {
+                game.position.make_null_move(undo_stack[ply]);
+                move_stack[ply] = 0;
+                keys.push_back(game.position.hash());
+            }
+
+            void undo_null_move(int ply)
             {
-                for (int pt = 0; pt < 6; ++pt)
+                keys.pop_back();
+                game.position.undo_null_move(undo_stack[ply]);
+            }
+
+            // Move that led to the position at ply, 0 after a null move (or at the start of a game)
+            Move previous_move(int ply) const
+            {
+                if (ply > 0)
+                    return move_stack[ply - 1];
+                return game.moves.empty() ? 0 : game.moves.back();
+            }
+
+            // The position at ply occurred before since the last capture or pawn move (and null move):
+            // once inside the search, as whoever repeated it can repeat it again, or twice before the root
+            bool is_repetition(int ply) const
+            {
+                int window = (int)game.position.halfmove_clock;
+                for (int p = ply - 1; p >= 0; --p)
                 {
-                    if (pos.pieces[1 ^ (u8)pos.turn()][pt] & (1ULL << to_sq))
-                        score += (pt + 1) * 100; // victim
-                    if (pos.pieces[(u8)pos.turn()][pt] & (1ULL << from_sq))
-                        score -= (pt + 1) * 10; // attacker
+                    if (!move_stack[p])
+                    {
+                        window = std::min(window, ply - p);
+                        break;
+                    }
                 }
+
+                const int current = (int)keys.size() - 1;
+                const int oldest = std::max(0, current - window);
+                int count = 0;
+                for (int i = current - 2; i >= oldest; i -= 2)
+                {
+                    if (keys[i] == keys[current] && (i >= (int)root_index || ++count == 2))
+                        return true;
+                }
+                return false;
             }
 
-            // Promotion bonus
-            if (move::is_promotion(m))
+            // move at ply beat alpha, its line becomes move followed by the child's line
+            void update_pv(int ply, Move move)
             {
-                score += 800;
+                pv[ply][ply] = move;
+                int len = ply + 1;
+                if (ply + 1 < MAX_PLY)
+                {
+                    for (int i = ply + 1; i < pv_length[ply + 1]; ++i)
+                        pv[ply][len++] = pv[ply + 1][i];
+                }
+                pv_length[ply] = len;
             }
 
-            // Central pawn push
-            const bool is_pawn = pos.pieces[(u8)pos.turn()][0] & (1ULL << from_sq);
-            if (is_pawn && (to_sq == 27 || to_sq == 28 || to_sq == 35 || to_sq == 36))
+            // Polled from inside the tree, only looks at the clock every few thousand nodes.
+            // Depth 1 of the main thread always runs to completion so there is a move to play.
+            bool should_stop()
             {
-                score += 20; // moving into e4/d4/d5/e5
+                if (stopped)
+                    return true;
+
+                if ((nodes & (CHECK_INTERVAL - 1)) == 0)
+                {
+                    u64 total = shared.nodes.fetch_add(CHECK_INTERVAL, std::memory_order_relaxed) + CHECK_INTERVAL;
+                    if (shared.can_stop.load(std::memory_order_relaxed))
+                    {
+                        if ((shared.limits.nodes && total >= shared.limits.nodes) ||
+                            (shared.hard_limit_ms && shared.clock_ms() >= shared.hard_limit_ms))
+                            shared.stop.store(true, std::memory_order_relaxed);
+                    }
+                    if (shared.stop_requested())
+                        shared.stop.store(true, std::memory_order_relaxed);
+                }
+
+                if (shared.stop.load(std::memory_order_relaxed) && (!is_main() || shared.can_stop.load(std::memory_order_relaxed)))
+                    stopped = true;
+                return stopped;
             }
+        };
 
+        // Splits the remaining clock into a soft (per-iteration) and hard (abort) budget
+        static void init_time(SharedSearch &shared, Color us)
+        {
+            const SearchLimits &limits = shared.limits;
+            constexpr int move_overhead = 10; // ms reserved for communication/UI
+
+            if (limits.movetime > 0)
+            {
+                // The whole budget is meant to be used, the hard limit ends the last iteration
+                shared.hard_limit_ms = std::max(1, limits.movetime - move_overhead);
+                return;
+            }
+
+            const int time = (us == Color::WHITE) ? limits.wtime : limits.btime;
+            const int inc = (us == Color::WHITE) ? limits.winc : limits.binc;
+            if (time <= 0)
+                return; // depth/node limited only
+
+            const int moves_to_go = limits.movestogo > 0 ? std::min(limits.movestogo, 50) : 30;
+            const int available = std::max(1, time - move_overhead);
+
+            i64 optimum = available / moves_to_go + inc * 3 / 4;
+            i64 maximum = std::min<i64>(optimum * 4, available / 3 + inc);
+
+            shared.hard_limit_ms = std::max<i64>(1, std::min<i64>(maximum, available));
+            // An iteration takes several times as long as the previous one, so one started
+            // past half the optimum would most likely run over it
+            shared.soft_limit_ms = std::max<i64>(1, std::min(optimum, shared.hard_limit_ms) / 2);
+        }
+
+        // Mate scores are stored relative to the node rather than the root,
+        // so they stay valid when the position is reached through a different path
+        static int score_to_tt(int score, int ply)
+        {
+            if (score >= MATE_BOUND)
+                return score + ply;
+            if (score <= -MATE_BOUND)
+                return score - ply;
             return score;
         }
 
-        static int negamax(Game &game, int depth, int alpha, int beta)
+        static int score_from_tt(int score, int ply)
         {
+            if (score >= MATE_BOUND)
+                return score - ply;
+            if (score <= -MATE_BOUND)
+                return score + ply;
+            return score;
+        }
+
+        // Margin added to a capture's gain before delta pruning it in quiescence
+        static constexpr int DELTA_MARGIN = 200;
+
+        static constexpr int NULL_MOVE_MIN_DEPTH = 3;
+        static constexpr int LMR_MIN_DEPTH = 3;
+
+        // Late move reduction in plies, by [depth][move number], growing with the log of both
+        static const struct ReductionTable
+        {
+            int table[64][64];
+
+            ReductionTable()
+            {
+                for (int d = 0; d < 64; ++d)
+                {
+                    for (int n = 0; n < 64; ++n)
+                        table[d][n] = (d && n) ? (int)(0.75 + std::log(d) * std::log(n) / 2.25) : 0;
+                }
+            }
+        } reductions;
+
+        static bool has_non_pawn_material(const Position &pos, Color c)
+        {
+            const u64 *pieces = pos.pieces[(u8)c];
+            return pieces[(int)PieceType::KNIGHT] | pieces[(int)PieceType::BISHOP] |
+                   pieces[(int)PieceType::ROOK] | pieces[(int)PieceType::QUEEN];
+        }
+
+        static int evaluate(SearchContext &ctx)
+        {
+            const Position &pos = ctx.game.position;
+            const int score = eval(pos, ctx.pawn_table);
+            return (pos.turn() == Color::WHITE) ? score : -score;
+        }
+
+        // Resolves captures (and check evasions) past the horizon so the static eval
+        // is only ever taken in a quiet position. With checks, its first ply also tries
+        // quiet checking moves, which the evasion that follows keeps from recursing.
+        static int quiescence(SearchContext &ctx, int ply, int alpha, int beta, bool checks = false)
+        {
+            Position &pos = ctx.game.position;
+
+            ctx.pv_length[ply] = ply;
+            ctx.seldepth = std::max(ctx.seldepth, ply);
+
+            ++ctx.nodes;
+            if (ctx.should_stop())
+                return 0;
+
+            const bool in_check = pos.king_checked(pos.turn());
+            if (ply >= MAX_PLY - 1)
+                return in_check ? DRAW_SCORE : evaluate(ctx);
+
+            int best = -INF;
+            int stand_pat = -INF;
+
+            if (!in_check)
+            {
+                // Stand pat: the side to move can usually do at least as well as the static eval
+                stand_pat = evaluate(ctx);
+                if (stand_pat >= beta)
+                    return stand_pat;
+                if (stand_pat > alpha)
+                    alpha = stand_pat;
+                best = stand_pat;
+            }
+
+            // In check every evasion is searched, otherwise captures (and quiet checks)
+            MovePicker picker(pos, in_check, checks);
+            int n_searched = 0;
+
+            while (const Move m = picker.next())
+            {
+                if (!in_check)
+                {
+                    // Delta pruning: even winning the captured piece outright can't reach alpha
+                    if (move::is_capture(m) && !move::is_promotion(m))
+                    {
+                        const PieceType victim = move::is_en_passant(m) ? PieceType::PAWN : pos.piece_on(Color(1 ^ (u8)pos.turn()), move::to(m));
+                        if (stand_pat + see_values[(u8)victim] + DELTA_MARGIN <= alpha)
+                            continue;
+                    }
+
+                    // SEE pruning: captures (and checks) that lose material in the exchange
+                    if (!pos.see_ge(m, 0))
+                        continue;
+                }
+
+                ++n_searched;
+                UndoState undo;
+                pos.make_move(m, undo);
+                int score = -quiescence(ctx, ply + 1, -beta, -alpha);
+                pos.undo_move(undo);
+
+                if (ctx.stopped)
+                    return 0;
+
+                if (score > best)
+                {
+                    best = score;
+                    if (score > alpha)
+                        alpha = score;
+                    if (alpha >= beta)
+                        break;
+                }
+            }
+
+            if (in_check && n_searched == 0)
+                return -MATE_SCORE + ply;
+
+            return best;
+        }
+
+        static int negamax(SearchContext &ctx, int depth, int ply, int alpha, int beta)
+        {
+            Game &game = ctx.game;
             Position &pos = game.position;
 
-            if (depth == 0)
-                return (pos.turn() == Color::WHITE) ? eval(pos) : -eval(pos);
-            if (game.is_draw())
+            if (depth <= 0)
+                return quiescence(ctx, ply, alpha, beta, true);
+
+            ctx.pv_length[ply] = ply;
+            ctx.seldepth = std::max(ctx.seldepth, ply);
+
+            ++ctx.nodes;
+            if (ctx.should_stop())
+                return 0;
+
+            if (pos.halfmove_clock >= 100 || ctx.is_repetition(ply))
                 return DRAW_SCORE;
 
-            Move moves[256];
-            std::size_t n_moves = get_moves(pos, moves);
+            const int alpha_orig = alpha;
+            const u64 key = pos.hash();
 
-            if (n_moves == 0)
+            // PV nodes never take a table cutoff, which would cut the reported line short
+            const bool pv_node = beta - alpha > 1;
+
+            Move tt_move = 0;
+            TTData tt_data;
+            if (tt.probe(key, tt_data))
             {
-                if (pos.king_checked(pos.turn()))
-                    return -MATE_SCORE - depth;
-                else
-                    return DRAW_SCORE;
+                tt_move = tt_data.move;
+                if (!pv_node && tt_data.depth >= depth)
+                {
+                    int tt_score = score_from_tt(tt_data.score, ply);
+                    if (tt_data.bound == Bound::EXACT ||
+                        (tt_data.bound == Bound::LOWER && tt_score >= beta) ||
+                        (tt_data.bound == Bound::UPPER && tt_score <= alpha))
+                        return tt_score;
+                }
             }
 
-            // Score and sort moves
-            std::vector<std::pair<Move, int>> sorted_moves;
-            sorted_moves.reserve(n_moves);
-            for (std::size_t i = 0; i < n_moves; ++i)
+            const bool in_check = pos.king_checked(pos.turn());
+            const bool after_null = ply > 0 && ctx.move_stack[ply - 1] == 0;
+
+            // Null move pruning: if passing the turn still fails high on a reduced search,
+            // a real move almost certainly does too. Not done in check, twice in a row,
+            // or with only king and pawns left, where zugzwang makes passing a real advantage.
+            if (ctx.shared.null_move && !pv_node && !in_check && !after_null && depth >= NULL_MOVE_MIN_DEPTH &&
+                std::abs(beta) < MATE_BOUND && has_non_pawn_material(pos, pos.turn()) && evaluate(ctx) >= beta)
             {
-                int score = score_move(pos, moves[i]);
-                sorted_moves.emplace_back(moves[i], score);
-            }
+                const int r = 3 + depth / 4;
+                ctx.make_null_move(ply);
+                int score = -negamax(ctx, depth - 1 - r, ply + 1, -beta, -beta + 1);
+                ctx.undo_null_move(ply);
 
-            std::sort(sorted_moves.begin(), sorted_moves.end(),
-                      [](const auto &a, const auto &b)
-                      { return a.second > b.second; });
+                if (ctx.stopped)
+                    return 0;
+                if (score >= beta)
+                    return score >= MATE_BOUND ? beta : score; // unproven mates aren't trusted
+            }
 
+            const Move prev_move = ctx.previous_move(ply);
+            MovePicker picker(pos, tt_move, in_check, &ctx.history, ply, prev_move);
             int max_eval = -INF;
+            Move best_move = 0;
+            int n_searched = 0;
+
+            // Quiet moves that failed to cut off, penalized if a later one does
+            Move quiets_tried[64];
+            int n_quiets = 0;
 
-            for (const auto &[move, _] : sorted_moves)
+            while (const Move move = picker.next())
             {
-                game.make_move(move);
-                int score = -negamax(game, depth - 1, -beta, -alpha);
-                game.undo_move();
+                ++n_searched;
+                const bool is_quiet = !move::is_capture(move) && !move::is_promotion(move);
+
+                ctx.make_move(ply, move);
+                int score;
+                if (n_searched == 1)
+                    score = -negamax(ctx, depth - 1, ply + 1, -beta, -alpha);
+                else
+                {
+                    // Late move reductions: quiet moves ordered this late rarely matter,
+                    // so search them shallower first and only at full depth if they beat alpha
+                    int r = 0;
+                    if (ctx.shared.lmr && is_quiet && depth >= LMR_MIN_DEPTH && !in_check && !pos.king_checked(pos.turn()))
+                    {
+                        r = reductions.table[std::min(depth, 63)][std::min(n_searched, 63)] - (pv_node ? 1 : 0);
+                        r = std::clamp(r, 0, depth - 2);
+                    }
+
+                    // Principal variation search: assume the first move was best and only
+                    // prove the others aren't with a null window, searching fully if one is
+                    score = -negamax(ctx, depth - 1 - r, ply + 1, -alpha - 1, -alpha);
+                    if (r > 0 && score > alpha && !ctx.stopped)
+                        score = -negamax(ctx, depth - 1, ply + 1, -alpha - 1, -alpha);
+                    if (score > alpha && score < beta && !ctx.stopped)
+                        score = -negamax(ctx, depth - 1, ply + 1, -beta, -alpha);
+                }
+                ctx.undo_move(ply);
+
+                if (ctx.stopped)
+                    return 0; // result is incomplete, don't let it reach the table
 
                 if (score > max_eval)
+                {
                     max_eval = score;
+                    best_move = move;
+                }
                 if (score > alpha)
+                {
                     alpha = score;
+                    ctx.update_pv(ply, move);
+                }
                 if (alpha >= beta)
+                {
+                    if (is_quiet)
+                        ctx.history.update_quiets(pos.turn(), ply, depth, prev_move, move, quiets_tried, n_quiets);
                     break; // beta cutoff
+                }
+
+                if (is_quiet && n_quiets < 64)
+                    quiets_tried[n_quiets++] = move;
             }
 
+            if (n_searched == 0)
+                return in_check ? -MATE_SCORE + ply : DRAW_SCORE;
+
+            Bound bound = (max_eval <= alpha_orig) ? Bound::UPPER
+                          : (max_eval >= beta)     ? Bound::LOWER
+                                                   : Bound::EXACT;
+            tt.store(key, (bound == Bound::UPPER) ? 0 : best_move, score_to_tt(max_eval, ply), depth, bound);
+
             return max_eval;
         }
 
-        Move solve(Game &game, int depth, int *eval_centipawns)
+        // Searches every root move to the given depth inside the (alpha, beta) window and returns
+        // the best score, which is only a bound if it falls outside the window. best_move is set
+        // unless every move failed low. moves[0] is expected to hold the best move of the previous
+        // iteration. Check ctx.stopped before using the result.
+        static int search_root(SearchContext &ctx, Move *moves, std::size_t n_moves, int depth, int alpha, int beta, Move &best_move)
         {
-            Move moves[256];
-            std::size_t n_moves = get_moves(game.position, moves);
-
-            Move best_move = 0;
-            int best_score = -INF;
-            int alpha = -INF, beta = INF;
+            Game &game = ctx.game;
+            const int alpha_orig = alpha;
+            int iter_score = -INF;
+            ctx.pv_length[0] = 0;
+            Move iter_best = 0;
 
             for (std::size_t i = 0; i < n_moves; ++i)
             {
-                game.make_move(moves[i]);
-                int score = -negamax(game, depth - 1, -beta, -alpha);
-                game.undo_move();
+                ctx.make_move(0, moves[i]);
+                int score;
+                if (i == 0)
+                    score = -negamax(ctx, depth - 1, 1, -beta, -alpha);
+                else
+                {
+                    // Only needs to prove the move is worse than the current best
+                    score = -negamax(ctx, depth - 1, 1, -alpha - 1, -alpha);
+                    if (score > alpha && score < beta && !ctx.stopped)
+                        score = -negamax(ctx, depth - 1, 1, -beta, -alpha);
+                }
+                ctx.undo_move(0);
 
-                if (score > best_score)
+                if (ctx.stopped)
+                    return 0;
+
+                if (score > iter_score)
                 {
-                    best_score = score;
-                    best_move = moves[i];
+                    iter_score = score;
+                    if (score > alpha_orig)
+                        iter_best = moves[i];
                 }
 
                 if (score > alpha)
+                {
                     alpha = score;
+                    ctx.update_pv(0, moves[i]);
+                }
+                if (alpha >= beta)
+                    break;
+            }
+
+            if (iter_best)
+                best_move = iter_best;
+
+            Bound bound = (iter_score <= alpha_orig) ? Bound::UPPER
+                          : (iter_score >= beta)     ? Bound::LOWER
+                                                     : Bound::EXACT;
+            tt.store(game.position.hash(), (bound == Bound::UPPER) ? 0 : iter_best, score_to_tt(iter_score, 0), depth, bound);
+            return iter_score;
+        }
+
+        static SearchResult make_result(const SearchContext &ctx, u64 nodes, int seldepth, i64 time_ms)
+        {
+            SearchResult result;
+            result.best_move = ctx.best_move;
+            result.pv.assign(ctx.root_pv, ctx.root_pv + ctx.root_pv_length);
+            if (result.pv.size() > 1)
+                result.ponder_move = result.pv[1];
+
+            result.score = ctx.best_score;
+            if (result.score >= MATE_BOUND)
+                result.mate_in = (MATE_SCORE - result.score + 1) / 2;
+            else if (result.score <= -MATE_BOUND)
+                result.mate_in = -(MATE_SCORE + result.score) / 2;
+
+            result.depth = ctx.completed_depth;
+            result.seldepth = seldepth;
+            result.nodes = nodes;
+            result.time_ms = time_ms;
+            result.nps = nodes * 1000 / std::max<i64>(time_ms, 1);
+            result.hashfull = tt.hashfull();
+            return result;
+        }
+
+        // Iterative deepening loop run by every thread. Helpers with an odd id start one
+        // ply deeper than the main thread, so the threads spread over neighbouring depths
+        // and fill the shared table with results the others can use.
+        static void iterative_deepening(SearchContext &ctx)
+        {
+            SharedSearch &shared = ctx.shared;
+            Game &game = ctx.game;
+
+            Move moves[256];
+            std::size_t n_moves = get_moves(game.position, moves);
+            if (n_moves == 0)
+                return;
+
+            // Search the hash move from a previous search first, it tightens alpha the most
+            Move best_move = moves[0];
+            int best_score = 0;
+            TTData tt_data;
+            if (tt.probe(game.position.hash(), tt_data) && tt_data.move)
+                best_move = tt_data.move;
+
+            // Helpers also rotate the rest of the root moves so they don't walk the same order
+            if (!ctx.is_main() && n_moves > 1)
+                std::rotate(moves, moves + (ctx.id % n_moves), moves + n_moves);
+
+            const int max_depth = (shared.limits.depth > 0) ? std::min(shared.limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+            const int start_depth = ctx.is_main() ? 1 : std::min(max_depth, 1 + (ctx.id & 1));
+
+            for (int depth = start_depth; depth <= max_depth; ++depth)
+            {
+                // Previous iteration's best move goes first, the rest keep their order
+                auto it = std::find(moves, moves + n_moves, best_move);
+                if (it != moves + n_moves)
+                    std::rotate(moves, it, it + 1);
+
+                // Aspiration window: expect a score close to the previous iteration's and
+                // search a narrow window around it, widening on whichever side it fails
+                int delta = ASPIRATION_DELTA;
+                int alpha = -INF, beta = INF;
+                if (depth >= ASPIRATION_MIN_DEPTH && std::abs(best_score) < MATE_BOUND)
+                {
+                    alpha = std::max(best_score - delta, -INF);
+                    beta = std::min(best_score + delta, INF);
+                }
+
+                int score;
+                while (true)
+                {
+                    score = search_root(ctx, moves, n_moves, depth, alpha, beta, best_move);
+                    if (ctx.stopped)
+                        break;
+
+                    if (score <= alpha && alpha > -INF)
+                        alpha = std::max(score - delta, -INF);
+                    else if (score >= beta && beta < INF)
+                    {
+                        beta = std::min(score + delta, INF);
+
+                        // Search the move that failed high first on the retry
+                        auto it = std::find(moves, moves + n_moves, best_move);
+                        std::rotate(moves, it, it + 1);
+                    }
+                    else
+                        break;
+
+                    delta *= 2;
+                }
+
+                if (ctx.stopped)
+                    break;
+                best_score = score;
+
+                ctx.completed_depth = depth;
+                ctx.best_move = best_move;
+                ctx.best_score = best_score;
+
+                if (ctx.pv_length[0] > 0 && ctx.pv[0][0] == best_move)
+                {
+                    std::copy(ctx.pv[0], ctx.pv[0] + ctx.pv_length[0], ctx.root_pv);
+                    ctx.root_pv_length = ctx.pv_length[0];
+                }
+                else
+                {
+                    ctx.root_pv[0] = best_move;
+                    ctx.root_pv_length = 1;
+                }
+
+                if (!ctx.is_main())
+                    continue;
+
+                shared.can_stop.store(true, std::memory_order_relaxed);
+
+                // Helpers only publish their node counts in chunks, so this is approximate
+                if (shared.on_iteration)
+                {
+                    const u64 nodes = std::max<u64>(ctx.nodes, shared.nodes.load(std::memory_order_relaxed));
+                    shared.on_iteration(make_result(ctx, nodes, ctx.seldepth, shared.elapsed_ms()));
+                }
+
+                if (shared.soft_limit_ms && shared.clock_ms() >= shared.soft_limit_ms)
+                    break;
+                // Mate found, deeper searches won't improve on it
+                if (std::abs(best_score) >= MATE_BOUND && depth > MATE_SCORE - std::abs(best_score))
+                    break;
+                if (shared.stop_requested())
+                    break;
+            }
+        }
+
+        // Expected reply when the PV got cut short (e.g. by a hash hit at the root's child)
+        static Move ponder_from_tt(Game &game, Move best_move)
+        {
+            Move reply = 0;
+            TTData tt_data;
+
+            game.make_move(best_move);
+            if (tt.probe(game.position.hash(), tt_data) && tt_data.move)
+            {
+                Move moves[256];
+                std::size_t n_moves = get_moves(game.position, moves);
+                if (std::find(moves, moves + n_moves, tt_data.move) != moves + n_moves)
+                    reply = tt_data.move;
             }
+            game.undo_move();
+
+            return reply;
+        }
+
+        SearchResult solve(Game &game, const SearchLimits &limits, const IterationCallback &on_iteration)
+        {
+            if (tt.empty())
+                tt.resize(TranspositionTable::DEFAULT_SIZE_MB);
+            tt.new_search();
+
+            SharedSearch shared(limits, on_iteration);
+            init_time(shared, game.position.turn());
+
+            if (pawn_tables.size() < (std::size_t)thread_count)
+                pawn_tables.resize(thread_count);
+
+            // The network may have been enabled since the position was set up
+            game.position.refresh_accumulator();
+
+            // Lazy SMP: helpers search the same root on their own copy of the game,
+            // sharing work only through the transposition table
+            std::vector<Game> helper_games(thread_count - 1, game);
+            std::vector<SearchContext> contexts;
+            contexts.reserve(thread_count);
+            contexts.emplace_back(game, shared, 0);
+            for (int i = 1; i < thread_count; ++i)
+                contexts.emplace_back(helper_games[i - 1], shared, i);
+
+            std::vector<std::thread> helpers;
+            for (int i = 1; i < thread_count; ++i)
+                helpers.emplace_back(iterative_deepening, std::ref(contexts[i]));
+
+            iterative_deepening(contexts[0]);
+
+            shared.stop.store(true, std::memory_order_relaxed);
+            for (std::thread &t : helpers)
+                t.join();
+
+            // Prefer the deepest completed iteration, ties go to the main thread
+            const SearchContext *best = &contexts[0];
+            for (const SearchContext &ctx : contexts)
+            {
+                if (ctx.completed_depth > best->completed_depth && ctx.best_move)
+                    best = &ctx;
+            }
+
+            u64 nodes = 0;
+            int seldepth = 0;
+            for (const SearchContext &ctx : contexts)
+            {
+                nodes += ctx.nodes;
+                seldepth = std::max(seldepth, ctx.seldepth);
+            }
+
+            SearchResult result = make_result(*best, nodes, seldepth, shared.elapsed_ms());
+            if (!result.ponder_move && result.best_move)
+                result.ponder_move = ponder_from_tt(game, result.best_move);
+
+            return result;
+        }
+
+        Move solve(Game &game, int depth, int *eval_centipawns)
+        {
+            SearchLimits limits;
+            limits.depth = depth;
+            SearchResult result = solve(game, limits);
 
             if (eval_centipawns)
-                *eval_centipawns = best_score;
+                *eval_centipawns = result.score;
 
-            return best_move;
+            return result.best_move;
+        }
+
+        void set_threads(int threads)
+        {
+            thread_count = std::clamp(threads, 1, MAX_THREADS);
+        }
+
+        void set_null_move_pruning(bool enabled)
+        {
+            null_move_enabled = enabled;
+        }
+
+        void set_late_move_reductions(bool enabled)
+        {
+            lmr_enabled = enabled;
+        }
+
+        void set_hash_size(std::size_t mb)
+        {
+            tt.resize(mb);
+        }
+
+        void clear_hash()
+        {
+            if (tt.empty())
+                tt.resize(TranspositionTable::DEFAULT_SIZE_MB);
+            else
+                tt.clear();
         }
 
     } // namespace engine
@@ -1,87 +1,80 @@
 #include "eval.hpp"
 #include <bit>
 
-#include "pst.hpp"
+#include "chess/bitboard.hpp"
+#include "chess/nnue.hpp"
+#include "kernels.hpp"
+#include "pawns.hpp"
 
 namespace chess
 {
     namespace engine
     {
-        static constexpr int piece_values[6] = {
-            100, 320, 330, 500, 900, 0};
+        // Per safe square attacked, indexed by piece type (knight to queen)
+        static constexpr psqt::Score mobility_weights[6] = {{0, 0}, {4, 4}, {5, 5}, {2, 4}, {1, 2}, {0, 0}};
 
-        // Midgame phase weights (used for tapered eval)
-        static constexpr int phase_weights[6] = {
-            0, 1, 1, 2, 4, 0 // pawn, knight, bishop, rook, queen, king
-        };
+        // At most 15 non-pawn, non-king pieces per side
+        static constexpr int MAX_MOBILE_PIECES = 32;
 
-        static int total_phase(const Position &pos)
+        // Squares attacked by c's pawns
+        static u64 pawn_attack_span(const Position &pos, Color c)
         {
-            int phase = 0;
-            for (int c = 0; c < 2; ++c)
-            {
-                for (int pt = 0; pt < 6; ++pt)
-                {
-                    phase += __builtin_popcountll(pos.pieces[c][pt]) * phase_weights[pt];
-                }
-            }
-            return phase;
+            const u64 pawns = pos.get_piece_bb(c, PieceType::PAWN);
+            return c == Color::WHITE ? ((pawns << 9) & ~bitboard::FILE_A) | ((pawns << 7) & ~bitboard::FILE_H)
+                                     : ((pawns >> 7) & ~bitboard::FILE_A) | ((pawns >> 9) & ~bitboard::FILE_H);
         }
 
-        static bool is_passed_pawn(const Position &pos, Color us, u8 square)
+        // Squares each knight, bishop, rook and queen attacks that are neither occupied by its own side
+        // nor covered by an enemy pawn. The attack sets of both sides are gathered first and then
+        // counted and weighted in one batch by the vectorized kernel.
+        static psqt::Score mobility(const Position &pos)
         {
-            u64 forward_mask = (us == Color::WHITE) ? 0xFFFFFFFFFFFFFFFFULL << (square + 8)
-                                                    : 0xFFFFFFFFFFFFFFFFULL >> (63 - square + 8);
+            u64 attacks[MAX_MOBILE_PIECES];
+            i32 mg_weights[MAX_MOBILE_PIECES], eg_weights[MAX_MOBILE_PIECES];
+            int n = 0;
 
-            u64 file_mask = 0x0101010101010101ULL << (square % 8);
-            u64 adjacent = file_mask;
-            if (square % 8 > 0)
-                adjacent |= file_mask >> 1;
-            if (square % 8 < 7)
-                adjacent |= file_mask << 1;
+            for (int c = 0; c < 2; ++c)
+            {
+                const Color us = static_cast<Color>(c);
+                const int sign = (us == Color::WHITE) ? 1 : -1;
+                const u64 safe = ~pos.occupancy[c] & ~pawn_attack_span(pos, Color(1 ^ c));
 
-            Color them = us == Color::WHITE ? Color::BLACK : Color::WHITE;
-            u64 their_pawns = pos.pieces[(int)them][(int)PieceType::PAWN];
+                for (int pt = (int)PieceType::KNIGHT; pt <= (int)PieceType::QUEEN; ++pt)
+                {
+                    for (u64 bb = pos.pieces[c][pt]; bb && n < MAX_MOBILE_PIECES; bb &= bb - 1)
+                    {
+                        attacks[n] = piece_attacks((PieceType)pt, __builtin_ctzll(bb), pos.all_occupancy) & safe;
+                        mg_weights[n] = sign * mobility_weights[pt].mg;
+                        eg_weights[n] = sign * mobility_weights[pt].eg;
+                        ++n;
+                    }
+                }
+            }
 
-            return (their_pawns & adjacent & forward_mask) == 0;
+            return kernels::weighted_popcount(attacks, mg_weights, eg_weights, n);
         }
 
-        int eval(const Position &pos)
+        int eval(const Position &pos, PawnTable &pawn_table)
         {
-            int mg_score = 0;
-            int eg_score = 0;
-            int phase = total_phase(pos);
-            constexpr int max_phase = 24; // 2*(1+1+2)+4=12, max phase for both sides
-
-            for (int c = 0; c < 2; ++c)
+            if (nnue::enabled())
             {
-                Color color = static_cast<Color>(c);
-                int sign = (color == Color::WHITE) ? 1 : -1;
-
-                for (int pt = 0; pt < 6; ++pt)
-                {
-                    PieceType piece = static_cast<PieceType>(pt);
-                    u64 bb = pos.pieces[c][pt];
-
-                    while (bb)
-                    {
-                        u8 square = __builtin_ctzll(bb);
-                        bb &= bb - 1;
+                const int score = nnue::evaluate(pos.accumulator, (u8)pos.turn());
+                return pos.turn() == Color::WHITE ? score : -score;
+            }
 
-                        mg_score += sign * piece_values[pt];
-                        mg_score += sign * PST[MIDGAME][pt][mirror_square(color, square)];
+            // Material and piece-square terms are maintained incrementally by the position
+            int mg_score = pos.psq.mg;
+            int eg_score = pos.psq.eg;
+            int phase = pos.phase;
+            constexpr int max_phase = psqt::MAX_PHASE;
 
-                        eg_score += sign * piece_values[pt];
-                        eg_score += sign * PST[ENDGAME][pt][mirror_square(color, square)];
+            const PawnEntry &pawns = pawn_table.probe(pos);
+            mg_score += pawns.score.mg;
+            eg_score += pawns.score.eg;
 
-                        if (piece == PieceType::PAWN && is_passed_pawn(pos, color, square))
-                        {
-                            mg_score += sign * 20;
-                            eg_score += sign * 40;
-                        }
-                    }
-                }
-            }
+            const psqt::Score mob = mobility(pos);
+            mg_score += mob.mg;
+            eg_score += mob.eg;
 
             // Tapered eval: blend midgame/endgame score based on remaining material
             int score = (mg_score * phase + eg_score * (max_phase - phase)) / max_phase;
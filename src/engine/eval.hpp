@@ -1,11 +1,13 @@
 #pragma once
 
 #include "chess/position.hpp"
+#include "pawns.hpp"
 
 namespace chess
 {
     namespace engine
     {
-        int eval(const Position &pos);
+        // White's point of view, pawn structure looked up in (and added to) pawn_table
+        int eval(const Position &pos, PawnTable &pawn_table);
     } // namespace engine
 } // namespace chess
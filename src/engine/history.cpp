@@ -0,0 +1,43 @@
+#include "history.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace chess
+{
+    namespace engine
+    {
+        void SearchHistory::clear()
+        {
+            std::memset(killers, 0, sizeof(killers));
+            std::memset(butterfly, 0, sizeof(butterfly));
+            std::memset(countermoves, 0, sizeof(countermoves));
+        }
+
+        // Moves entry towards +-HISTORY_MAX, by less the closer it already is,
+        // so scores stay bounded and old statistics fade out
+        static void apply_gravity(i16 &entry, int bonus)
+        {
+            entry += bonus - entry * std::abs(bonus) / SearchHistory::HISTORY_MAX;
+        }
+
+        void SearchHistory::update_quiets(Color c, int ply, int depth, Move prev, Move best, const Move *tried, int n_tried)
+        {
+            if (killers[ply][0] != best)
+            {
+                killers[ply][1] = killers[ply][0];
+                killers[ply][0] = best;
+            }
+
+            if (prev)
+                countermoves[move::from(prev)][move::to(prev)] = best;
+
+            const int bonus = std::min(depth * depth, 1200);
+            apply_gravity(butterfly[(u8)c][move::from(best)][move::to(best)], bonus);
+            for (int i = 0; i < n_tried; ++i)
+                apply_gravity(butterfly[(u8)c][move::from(tried[i])][move::to(tried[i])], -bonus);
+        }
+
+    } // namespace engine
+} // namespace chess
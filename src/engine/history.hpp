@@ -0,0 +1,35 @@
+#pragma once
+
+#include "chess/position.hpp"
+
+namespace chess
+{
+    namespace engine
+    {
+        constexpr int MAX_PLY = 128;
+
+        // Quiet move ordering statistics gathered from beta cutoffs, one instance per search thread.
+        //  killers       the last two quiet moves that cut off at each ply
+        //  butterfly     how often a quiet [color][from][to] caused a cutoff versus failed to, with gravity
+        //  countermoves  the quiet move that last refuted the previous move, indexed by its [from][to]
+        struct SearchHistory
+        {
+            static constexpr int HISTORY_MAX = 16384;
+
+            Move killers[MAX_PLY][2];
+            i16 butterfly[2][64][64];
+            Move countermoves[64][64];
+
+            SearchHistory() { clear(); }
+
+            void clear();
+
+            inline int quiet_score(Color c, Move m) const { return butterfly[(u8)c][move::from(m)][move::to(m)]; }
+            inline Move countermove(Move prev) const { return prev ? countermoves[move::from(prev)][move::to(prev)] : 0; }
+
+            // best cut off at ply after the quiets in tried[0, n_tried) failed to, prev is the move leading to the node
+            void update_quiets(Color c, int ply, int depth, Move prev, Move best, const Move *tried, int n_tried);
+        };
+
+    } // namespace engine
+} // namespace chess
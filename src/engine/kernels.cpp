@@ -0,0 +1,96 @@
+#include "kernels.hpp"
+
+#include "chess/cpu.hpp"
+
+#ifdef CHESS_X86
+#include <immintrin.h>
+#endif
+
+namespace chess
+{
+    namespace engine
+    {
+        namespace kernels
+        {
+            // Inlined into each caller so __builtin_popcountll is expanded for the caller's target:
+            // a library call in the portable kernel, one instruction in the popcnt one
+            __attribute__((always_inline)) static inline psqt::Score weighted_popcount_loop(const u64 *bitboards, const i32 *mg_weights, const i32 *eg_weights, int n)
+            {
+                psqt::Score s;
+                for (int i = 0; i < n; ++i)
+                {
+                    const int count = __builtin_popcountll(bitboards[i]);
+                    s.mg += count * mg_weights[i];
+                    s.eg += count * eg_weights[i];
+                }
+                return s;
+            }
+
+            static psqt::Score weighted_popcount_scalar(const u64 *bitboards, const i32 *mg_weights, const i32 *eg_weights, int n)
+            {
+                return weighted_popcount_loop(bitboards, mg_weights, eg_weights, n);
+            }
+
+#ifdef CHESS_X86
+            __attribute__((target("popcnt"))) static psqt::Score weighted_popcount_popcnt(const u64 *bitboards, const i32 *mg_weights, const i32 *eg_weights, int n)
+            {
+                return weighted_popcount_loop(bitboards, mg_weights, eg_weights, n);
+            }
+
+            // Four bitboards per iteration: nibble lookups give per byte counts, summed per 64-bit lane
+            // by a sum of absolute differences, then multiplied by the sign extended weights
+            __attribute__((target("avx2"))) static psqt::Score weighted_popcount_avx2(const u64 *bitboards, const i32 *mg_weights, const i32 *eg_weights, int n)
+            {
+                const __m256i nibble_counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                               0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+                const __m256i low_nibbles = _mm256_set1_epi8(0x0F);
+                const __m256i zero = _mm256_setzero_si256();
+
+                __m256i mg = zero, eg = zero;
+                int i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m256i bb = _mm256_loadu_si256((const __m256i *)(bitboards + i));
+                    const __m256i lo = _mm256_and_si256(bb, low_nibbles);
+                    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(bb, 4), low_nibbles);
+                    const __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(nibble_counts, lo), _mm256_shuffle_epi8(nibble_counts, hi));
+                    const __m256i counts = _mm256_sad_epu8(bytes, zero);
+
+                    const __m256i mg_w = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(mg_weights + i)));
+                    const __m256i eg_w = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(eg_weights + i)));
+                    mg = _mm256_add_epi64(mg, _mm256_mul_epi32(counts, mg_w));
+                    eg = _mm256_add_epi64(eg, _mm256_mul_epi32(counts, eg_w));
+                }
+
+                alignas(32) i64 mg_lanes[4], eg_lanes[4];
+                _mm256_store_si256((__m256i *)mg_lanes, mg);
+                _mm256_store_si256((__m256i *)eg_lanes, eg);
+
+                psqt::Score s = weighted_popcount_popcnt(bitboards + i, mg_weights + i, eg_weights + i, n - i);
+                s.mg += (i32)(mg_lanes[0] + mg_lanes[1] + mg_lanes[2] + mg_lanes[3]);
+                s.eg += (i32)(eg_lanes[0] + eg_lanes[1] + eg_lanes[2] + eg_lanes[3]);
+                return s;
+            }
+#endif
+
+            struct Kernels
+            {
+                psqt::Score (*weighted_popcount)(const u64 *, const i32 *, const i32 *, int);
+            };
+
+            static const Kernels selected = cpu::select<Kernels>({
+#ifdef CHESS_X86
+                {cpu::feature::AVX2 | cpu::feature::POPCNT, {weighted_popcount_avx2}},
+                {cpu::feature::POPCNT, {weighted_popcount_popcnt}},
+#endif
+                {0, {weighted_popcount_scalar}},
+            });
+
+            psqt::Score weighted_popcount(const u64 *bitboards, const i32 *mg_weights, const i32 *eg_weights, int n)
+            {
+                return selected.weighted_popcount(bitboards, mg_weights, eg_weights, n);
+            }
+        } // namespace kernels
+
+    } // namespace engine
+} // namespace chess
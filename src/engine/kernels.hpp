@@ -0,0 +1,18 @@
+#pragma once
+
+#include "chess/position.hpp"
+
+namespace chess
+{
+    namespace engine
+    {
+        // Batched evaluation kernels. Every kernel has an AVX2, a hardware popcnt and a portable
+        // version, the widest one the host supports is picked once at startup.
+        namespace kernels
+        {
+            // Sum over i < n of popcount(bitboards[i]) * weight, separately for the midgame and endgame weights
+            psqt::Score weighted_popcount(const u64 *bitboards, const i32 *mg_weights, const i32 *eg_weights, int n);
+        } // namespace kernels
+
+    } // namespace engine
+} // namespace chess
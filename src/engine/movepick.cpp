@@ -0,0 +1,229 @@
+#include "movepick.hpp"
+
+#include <utility>
+
+namespace chess
+{
+    namespace engine
+    {
+        MovePicker::MovePicker(const Position &pos, Move tt_move, bool in_check, const SearchHistory *history, int ply, Move prev_move)
+            : pos(pos), history(history), after_tt_move(in_check ? Stage::GEN_EVASIONS : Stage::GEN_CAPTURES), tt_move(tt_move)
+        {
+            stage = tt_move ? Stage::TT_MOVE : after_tt_move;
+
+            // Killers and countermoves are quiet moves from other lines, rarely evasions
+            if (history && !in_check)
+            {
+                killers[0] = history->killers[ply][0];
+                killers[1] = history->killers[ply][1];
+                countermove = history->countermove(prev_move);
+            }
+        }
+
+        MovePicker::MovePicker(const Position &pos, bool in_check, bool checks)
+            : pos(pos), history(nullptr), stage(in_check ? Stage::GEN_EVASIONS : Stage::QS_GEN_CAPTURES),
+              after_tt_move(stage), tt_move(0), qs_checks(checks)
+        {
+        }
+
+        int MovePicker::capture_score(Move m) const
+        {
+            int score = 0;
+
+            // MVV-LVA: most valuable victim first, cheapest attacker breaking ties
+            if (move::is_capture(m))
+            {
+                const Color them = Color(1 ^ (u8)pos.turn());
+                const PieceType victim = move::is_en_passant(m) ? PieceType::PAWN : pos.piece_on(them, move::to(m));
+                score += ((int)victim + 1) * 100 - ((int)pos.piece_on(pos.turn(), move::from(m)) + 1) * 10;
+            }
+            if (move::is_promotion(m))
+                score += see_values[move::promo_piece_index(m)];
+
+            return score;
+        }
+
+        void MovePicker::gen_captures()
+        {
+            capture_end = generate<GenType::CAPTURES>(pos, moves);
+            quiet_end = capture_end;
+
+            for (std::size_t i = 0; i < capture_end; ++i)
+                scores[i] = capture_score(moves[i]);
+        }
+
+        void MovePicker::gen_quiets()
+        {
+            quiet_end = capture_end + generate<GenType::QUIETS>(pos, moves + capture_end);
+
+            for (std::size_t i = capture_end; i < quiet_end; ++i)
+                scores[i] = history ? history->quiet_score(pos.turn(), moves[i]) : 0;
+        }
+
+        // Captures are scored above any history score so they come first
+        void MovePicker::gen_evasions()
+        {
+            quiet_end = generate<GenType::EVASIONS>(pos, moves);
+
+            for (std::size_t i = 0; i < quiet_end; ++i)
+            {
+                const Move m = moves[i];
+                if (move::is_capture(m) || move::is_promotion(m))
+                    scores[i] = SearchHistory::HISTORY_MAX + capture_score(m);
+                else
+                    scores[i] = history ? history->quiet_score(pos.turn(), m) : 0;
+            }
+        }
+
+        std::size_t MovePicker::select_best(std::size_t begin, std::size_t end)
+        {
+            std::size_t best = begin;
+            for (std::size_t i = begin + 1; i < end; ++i)
+            {
+                if (scores[i] > scores[best])
+                    best = i;
+            }
+            std::swap(moves[begin], moves[best]);
+            std::swap(scores[begin], scores[best]);
+            return begin;
+        }
+
+        bool MovePicker::is_special(Move m) const
+        {
+            return m == tt_move || m == killers[0] || m == killers[1] || m == countermove;
+        }
+
+        // Killers and countermoves come from other positions, so they are only played
+        // if legal here, and only if quiet so the capture stages don't return them again
+        bool MovePicker::is_legal_quiet(Move m) const
+        {
+            return !move::is_capture(m) && !move::is_promotion(m) && pos.is_legal(m);
+        }
+
+        Move MovePicker::next()
+        {
+            switch (stage)
+            {
+            case Stage::TT_MOVE:
+                // The hash move may come from a different position sharing the key
+                stage = after_tt_move;
+                if (pos.is_legal(tt_move))
+                    return tt_move;
+                tt_move = 0;
+                return next();
+
+            case Stage::GEN_CAPTURES:
+                gen_captures();
+                stage = Stage::GOOD_CAPTURES;
+                [[fallthrough]];
+
+            case Stage::GOOD_CAPTURES:
+                while (cur < capture_end)
+                {
+                    const Move m = moves[select_best(cur++, capture_end)];
+                    if (m == tt_move)
+                        continue;
+
+                    if (pos.see_ge(m, 0))
+                        return m;
+
+                    // Keep it for the last stage, still in MVV-LVA order
+                    moves[bad_end++] = m;
+                }
+                stage = Stage::KILLERS;
+                [[fallthrough]];
+
+            case Stage::KILLERS:
+                while (killer_index < 2)
+                {
+                    const Move killer = killers[killer_index++];
+                    if (!killer || killer == tt_move || (killer_index == 2 && killer == killers[0]))
+                        continue;
+
+                    if (is_legal_quiet(killer))
+                        return killer;
+                }
+                stage = Stage::COUNTERMOVE;
+                [[fallthrough]];
+
+            case Stage::COUNTERMOVE:
+                stage = Stage::GEN_QUIETS;
+                if (countermove && countermove != tt_move && countermove != killers[0] && countermove != killers[1] &&
+                    is_legal_quiet(countermove))
+                    return countermove;
+                [[fallthrough]];
+
+            case Stage::GEN_QUIETS:
+                gen_quiets();
+                cur = capture_end;
+                stage = Stage::QUIETS;
+                [[fallthrough]];
+
+            case Stage::QUIETS:
+                while (cur < quiet_end)
+                {
+                    const Move m = moves[select_best(cur++, quiet_end)];
+                    if (!is_special(m))
+                        return m;
+                }
+                stage = Stage::BAD_CAPTURES;
+                cur = 0;
+                [[fallthrough]];
+
+            case Stage::BAD_CAPTURES:
+                if (cur < bad_end)
+                    return moves[cur++];
+                stage = Stage::DONE;
+                return 0;
+
+            case Stage::QS_GEN_CAPTURES:
+                gen_captures();
+                stage = Stage::QS_CAPTURES;
+                [[fallthrough]];
+
+            case Stage::QS_CAPTURES:
+                if (cur < capture_end)
+                    return moves[select_best(cur++, capture_end)];
+                if (!qs_checks)
+                {
+                    stage = Stage::DONE;
+                    return 0;
+                }
+                stage = Stage::QS_GEN_CHECKS;
+                [[fallthrough]];
+
+            case Stage::QS_GEN_CHECKS:
+                quiet_end = capture_end + generate<GenType::QUIET_CHECKS>(pos, moves + capture_end);
+                cur = capture_end;
+                stage = Stage::QS_CHECKS;
+                [[fallthrough]];
+
+            case Stage::QS_CHECKS:
+                if (cur < quiet_end)
+                    return moves[cur++];
+                stage = Stage::DONE;
+                return 0;
+
+            case Stage::GEN_EVASIONS:
+                gen_evasions();
+                stage = Stage::EVASIONS;
+                [[fallthrough]];
+
+            case Stage::EVASIONS:
+                while (cur < quiet_end)
+                {
+                    const Move m = moves[select_best(cur++, quiet_end)];
+                    if (m != tt_move)
+                        return m;
+                }
+                stage = Stage::DONE;
+                return 0;
+
+            case Stage::DONE:
+                return 0;
+            }
+            return 0;
+        }
+
+    } // namespace engine
+} // namespace chess
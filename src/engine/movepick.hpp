@@ -0,0 +1,82 @@
+#pragma once
+
+#include "chess/position.hpp"
+#include "history.hpp"
+
+namespace chess
+{
+    namespace engine
+    {
+        // Hands out the legal moves of a node one at a time, best guesses first.
+        // The hash move, killers and countermove are checked with Position::is_legal on their own,
+        // captures and quiets are only generated when their stage is reached and only sorted as
+        // far as they are consumed, so a node that cuts off on its hash move generates nothing.
+        //
+        // Main search order: hash move, captures that don't lose material (MVV-LVA),
+        // killers, countermove, quiet moves by history score, losing captures.
+        // Quiescence order: captures and promotions (MVV-LVA), optionally followed by quiet checks.
+        // In check (either search) only the evasions are generated: hash move, then captures
+        // (MVV-LVA) ahead of the other evasions by history score.
+        class MovePicker
+        {
+        public:
+            // Without history quiet moves come in generation order.
+            // prev_move is the move that led to pos, used to look up the countermove.
+            MovePicker(const Position &pos, Move tt_move, bool in_check, const SearchHistory *history = nullptr, int ply = 0, Move prev_move = 0);
+
+            // Quiescence search, captures (plus quiet checks if checks) or every evasion when in check
+            MovePicker(const Position &pos, bool in_check, bool checks = false);
+
+            // Next move to search, 0 once all moves were returned
+            Move next();
+
+        private:
+            enum class Stage : u8
+            {
+                TT_MOVE,
+                GEN_CAPTURES,
+                GOOD_CAPTURES,
+                KILLERS,
+                COUNTERMOVE,
+                GEN_QUIETS,
+                QUIETS,
+                BAD_CAPTURES,
+                QS_GEN_CAPTURES,
+                QS_CAPTURES,
+                QS_GEN_CHECKS,
+                QS_CHECKS,
+                GEN_EVASIONS,
+                EVASIONS,
+                DONE,
+            };
+
+            int capture_score(Move m) const; // MVV-LVA plus the promotion gain
+            void gen_captures();
+            void gen_quiets();
+            void gen_evasions();
+            std::size_t select_best(std::size_t begin, std::size_t end); // moves the best scored move to begin
+            bool is_special(Move m) const;                                // hash move, killer or countermove, returned by their own stage
+            bool is_legal_quiet(Move m) const;
+
+            const Position &pos;
+            const SearchHistory *history;
+            Stage stage;
+            Stage after_tt_move; // GEN_CAPTURES, or GEN_EVASIONS in check
+            Move tt_move;
+            Move killers[2] = {0, 0};
+            Move countermove = 0;
+            int killer_index = 0;
+            bool qs_checks = false;
+
+            // Captures fill [0, capture_end), quiets [capture_end, quiet_end), evasions [0, quiet_end).
+            // Losing captures are moved to the front as they are rejected, [0, bad_end).
+            Move moves[256];
+            int scores[256];
+            std::size_t cur = 0;
+            std::size_t bad_end = 0;
+            std::size_t capture_end = 0;
+            std::size_t quiet_end = 0;
+        };
+
+    } // namespace engine
+} // namespace chess
@@ -0,0 +1,89 @@
+#include "pawns.hpp"
+
+#include "chess/bitboard.hpp"
+
+namespace chess
+{
+    namespace engine
+    {
+        static constexpr psqt::Score PASSED_BONUS = {20, 40};
+        static constexpr psqt::Score ISOLATED_PENALTY = {-10, -15};
+        static constexpr psqt::Score DOUBLED_PENALTY = {-10, -20};
+        static constexpr psqt::Score BACKWARD_PENALTY = {-8, -10};
+
+        static inline u64 north_fill(u64 b)
+        {
+            b |= b << 8;
+            b |= b << 16;
+            return b | (b << 32);
+        }
+
+        static inline u64 south_fill(u64 b)
+        {
+            b |= b >> 8;
+            b |= b >> 16;
+            return b | (b >> 32);
+        }
+
+        static inline u64 adjacent(u64 b) { return ((b << 1) & ~bitboard::FILE_A) | ((b >> 1) & ~bitboard::FILE_H); }
+
+        static inline u64 push(Color c, u64 b) { return c == Color::WHITE ? b << 8 : b >> 8; }
+        static inline u64 push_back(Color c, u64 b) { return c == Color::WHITE ? b >> 8 : b << 8; }
+
+        // Squares strictly in front of the pawns in b, as seen by side c
+        static inline u64 front_span(Color c, u64 b) { return c == Color::WHITE ? north_fill(b << 8) : south_fill(b >> 8); }
+
+        static inline u64 pawn_attacks(Color c, u64 b) { return adjacent(push(c, b)); }
+
+        static void evaluate_pawns(const Position &pos, PawnEntry &e)
+        {
+            e.score = {};
+            for (int c = 0; c < 2; ++c)
+            {
+                const Color us = static_cast<Color>(c);
+                const Color them = Color(1 ^ c);
+                const u64 ours = pos.get_piece_bb(us, PieceType::PAWN);
+                const u64 theirs = pos.get_piece_bb(them, PieceType::PAWN);
+
+                e.passed[c] = e.isolated[c] = 0;
+                for (u64 bb = ours; bb; bb &= bb - 1)
+                {
+                    const u8 sq = __builtin_ctzll(bb);
+                    if (!(bitboard::passed_mask[c][sq] & theirs))
+                        e.passed[c] |= bitboard::square_bb(sq);
+                    if (!(bitboard::adjacent_files[sq % 8] & ours))
+                        e.isolated[c] |= bitboard::square_bb(sq);
+                }
+                e.doubled[c] = ours & front_span(us, ours);
+
+                // Squares our pawns attack now or after advancing
+                const u64 attack_span = front_span(us, pawn_attacks(us, ours)) | pawn_attacks(us, ours);
+                e.backward[c] = push_back(us, push(us, ours) & pawn_attacks(them, theirs) & ~attack_span) & ~e.isolated[c];
+
+                const int sign = (us == Color::WHITE) ? 1 : -1;
+                const int n_passed = __builtin_popcountll(e.passed[c]);
+                const int n_isolated = __builtin_popcountll(e.isolated[c]);
+                const int n_doubled = __builtin_popcountll(e.doubled[c]);
+                const int n_backward = __builtin_popcountll(e.backward[c]);
+
+                e.score.mg += sign * (n_passed * PASSED_BONUS.mg + n_isolated * ISOLATED_PENALTY.mg +
+                                      n_doubled * DOUBLED_PENALTY.mg + n_backward * BACKWARD_PENALTY.mg);
+                e.score.eg += sign * (n_passed * PASSED_BONUS.eg + n_isolated * ISOLATED_PENALTY.eg +
+                                      n_doubled * DOUBLED_PENALTY.eg + n_backward * BACKWARD_PENALTY.eg);
+            }
+        }
+
+        // Empty entries have key 0 and zero scores, which is exactly what a position without pawns evaluates to
+        const PawnEntry &PawnTable::probe(const Position &pos)
+        {
+            PawnEntry &e = entries[pos.pawn_key & (ENTRIES - 1)];
+            if (e.key != pos.pawn_key)
+            {
+                evaluate_pawns(pos, e);
+                e.key = pos.pawn_key;
+            }
+            return e;
+        }
+
+    } // namespace engine
+} // namespace chess
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+
+#include "chess/position.hpp"
+
+namespace chess
+{
+    namespace engine
+    {
+        // Pawn structure of a position, depends on nothing but the pawns so it is cached by Position::pawn_key
+        struct PawnEntry
+        {
+            u64 key = 0;
+            u64 passed[2] = {0, 0};   // no enemy pawn ahead on the same or an adjacent file
+            u64 isolated[2] = {0, 0}; // no friendly pawn on an adjacent file
+            u64 doubled[2] = {0, 0};  // a friendly pawn behind on the same file
+            u64 backward[2] = {0, 0}; // can't be defended by a pawn and its stop square is attacked by one
+            psqt::Score score;        // all of the above, white's point of view
+        };
+
+        // Fixed size, power of two, always replace. Sibling nodes rarely change the pawns,
+        // so even a small table hits almost every time. The engine keeps one per search thread index.
+        class PawnTable
+        {
+        public:
+            static constexpr std::size_t ENTRIES = 1 << 14;
+
+            PawnTable() : entries(new PawnEntry[ENTRIES]) {}
+
+            // Entry for pos, evaluated and stored on a miss
+            const PawnEntry &probe(const Position &pos);
+
+        private:
+            std::unique_ptr<PawnEntry[]> entries;
+        };
+
+    } // namespace engine
+} // namespace chess
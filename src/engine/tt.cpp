@@ -0,0 +1,103 @@
+#include "tt.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace chess
+{
+    namespace engine
+    {
+        static constexpr auto relaxed = std::memory_order_relaxed;
+
+        void TranspositionTable::resize(std::size_t mb)
+        {
+            const std::size_t count = hash_table_slots(mb ? mb : 1, sizeof(Bucket));
+
+            if (count != bucket_count)
+            {
+                buckets.reset(new Bucket[count]);
+                bucket_count = count;
+            }
+            clear();
+        }
+
+        void TranspositionTable::clear()
+        {
+            std::memset(static_cast<void *>(buckets.get()), 0, bucket_count * sizeof(Bucket));
+            generation = 0;
+        }
+
+        bool TranspositionTable::probe(u64 key, TTData &out) const
+        {
+            const Bucket &bucket = bucket_for(key);
+            for (const HashEntry &e : bucket.entries)
+            {
+                u64 data;
+                if (!e.probe(key, data) || static_cast<Bound>((data >> 40) & 0b11) == Bound::NONE)
+                    continue;
+
+                out.move = static_cast<Move>(data & 0xFFFF);
+                out.score = static_cast<i16>((data >> 16) & 0xFFFF);
+                out.depth = depth_of(data);
+                out.bound = static_cast<Bound>((data >> 40) & 0b11);
+                return true;
+            }
+            return false;
+        }
+
+        void TranspositionTable::store(u64 key, Move move, int score, int depth, Bound bound)
+        {
+            Bucket &bucket = bucket_for(key);
+
+            // Prefer the slot already holding this position, otherwise the
+            // shallowest entry, with entries from older searches aging out first
+            HashEntry *replace = &bucket.entries[0];
+            u64 replace_data = replace->data.load(relaxed);
+            bool same_key = false;
+            int worst = 1 << 30;
+            for (HashEntry &e : bucket.entries)
+            {
+                u64 data;
+                if (e.probe(key, data))
+                {
+                    replace = &e;
+                    replace_data = data;
+                    same_key = true;
+                    break;
+                }
+
+                int age = (GENERATION_MASK + 1 + generation - generation_of(data)) & GENERATION_MASK;
+                int value = depth_of(data) - 8 * age;
+                if (value < worst)
+                {
+                    worst = value;
+                    replace = &e;
+                    replace_data = data;
+                }
+            }
+
+            // Keep the old best move if this search didn't produce one
+            if (!move && same_key)
+                move = static_cast<Move>(replace_data & 0xFFFF);
+
+            replace->store(key, pack(move, score, depth, bound, generation));
+        }
+
+        int TranspositionTable::hashfull() const
+        {
+            const std::size_t sample = std::min<std::size_t>(bucket_count, 1000 / ENTRIES_PER_BUCKET);
+            int used = 0;
+            for (std::size_t i = 0; i < sample; ++i)
+            {
+                for (const HashEntry &e : buckets[i].entries)
+                {
+                    const u64 data = e.data.load(relaxed);
+                    if (static_cast<Bound>((data >> 40) & 0b11) != Bound::NONE && generation_of(data) == generation)
+                        ++used;
+                }
+            }
+            return sample ? used * 1000 / (int)(sample * ENTRIES_PER_BUCKET) : 0;
+        }
+
+    } // namespace engine
+} // namespace chess
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "chess/hashtable.hpp"
+#include "chess/position.hpp"
+
+namespace chess
+{
+    namespace engine
+    {
+        enum class Bound : u8
+        {
+            NONE = 0,
+            UPPER = 1, // score <= stored score (failed low)
+            LOWER = 2, // score >= stored score (failed high)
+            EXACT = 3,
+        };
+
+        struct TTData
+        {
+            Move move;
+            i16 score;
+            u8 depth;
+            Bound bound;
+        };
+
+        // Fixed size, power of two transposition table.
+        // Entries are grouped into cache line sized buckets so a probe touches a single line.
+        // The table is shared between search threads without locking (see HashEntry).
+        class TranspositionTable
+        {
+        public:
+            static constexpr std::size_t DEFAULT_SIZE_MB = 16;
+
+            // Resizes (and clears) the table, rounding down to a power of two number of buckets
+            void resize(std::size_t mb);
+            void clear();
+
+            // Must be called once per search so older entries can be replaced first
+            void new_search() { generation = (generation + 1) & GENERATION_MASK; }
+
+            bool probe(u64 key, TTData &out) const;
+            void store(u64 key, Move move, int score, int depth, Bound bound);
+
+            bool empty() const { return bucket_count == 0; }
+
+            // Permille of sampled entries written by the current search
+            int hashfull() const;
+
+        private:
+            // data: [0, 16) move | [16, 32) score | [32, 40) depth | [40, 42) bound | [42, 48) generation
+            static constexpr int ENTRIES_PER_BUCKET = 4;
+            static constexpr u8 GENERATION_MASK = 0b111111;
+
+            struct alignas(64) Bucket
+            {
+                HashEntry entries[ENTRIES_PER_BUCKET];
+            };
+
+            static_assert(sizeof(Bucket) == 64, "TT bucket should fill exactly one cache line");
+
+            static constexpr u64 pack(Move move, int score, int depth, Bound bound, u8 generation)
+            {
+                return static_cast<u64>(move) |
+                       (static_cast<u64>(static_cast<u16>(score)) << 16) |
+                       (static_cast<u64>(static_cast<u8>(depth)) << 32) |
+                       (static_cast<u64>(bound) << 40) |
+                       (static_cast<u64>(generation & GENERATION_MASK) << 42);
+            }
+
+            static constexpr u8 generation_of(u64 data) { return (data >> 42) & GENERATION_MASK; }
+            static constexpr u8 depth_of(u64 data) { return (data >> 32) & 0xFF; }
+
+            Bucket &bucket_for(u64 key) { return buckets[key & (bucket_count - 1)]; }
+            const Bucket &bucket_for(u64 key) const { return buckets[key & (bucket_count - 1)]; }
+
+            std::unique_ptr<Bucket[]> buckets;
+            std::size_t bucket_count = 0;
+            u8 generation = 0;
+        };
+
+    } // namespace engine
+} // namespace chess
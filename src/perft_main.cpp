@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "chess/perft.hpp"
+#include "chess/position.hpp"
+
+static void usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " [options] <depth> [fen]\n"
+              << "  -d, --divide        print node counts for each root move\n"
+              << "  -t, --threads <n>   number of worker threads (default: all cores)\n"
+              << "  -H, --hash <mb>     size of the shared subtree cache, 0 to disable, at most 65536 (default: 128)\n"
+              << "FEN defaults to the starting position.\n";
+}
+
+// Parses a non-negative decimal integer, rejecting anything else
+static bool parse_count(const char *s, long long &out)
+{
+    char *end = nullptr;
+    errno = 0;
+    out = std::strtoll(s, &end, 10);
+    return end != s && *end == '\0' && errno == 0 && out >= 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool divide = false;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t hash_mb = 128;
+    int depth = -1;
+    std::string fen;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        long long value;
+        if (arg == "-d" || arg == "--divide")
+            divide = true;
+        else if ((arg == "-t" || arg == "--threads") && i + 1 < argc)
+        {
+            if (!parse_count(argv[++i], value) || value < 1 || value > 1024)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            threads = static_cast<int>(value);
+        }
+        else if ((arg == "-H" || arg == "--hash") && i + 1 < argc)
+        {
+            if (!parse_count(argv[++i], value) || value > 65536)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            hash_mb = static_cast<std::size_t>(value);
+        }
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (depth < 0)
+        {
+            if (!parse_count(arg.c_str(), value) || value > 255)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            depth = static_cast<int>(value);
+        }
+        else
+            fen += (fen.empty() ? "" : " ") + arg; // FEN may be passed unquoted
+    }
+
+    if (depth < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    chess::Position pos;
+    try
+    {
+        pos.from_fen(fen.empty() ? chess::default_fen : fen);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Invalid FEN: " << e.what() << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    chess::PerftResult result = chess::perft_divide(pos, depth, threads, hash_mb);
+    auto end = std::chrono::steady_clock::now();
+
+    if (divide)
+    {
+        for (const auto &[m, nodes] : result.divide)
+        {
+            std::cout << chess::move::to_uci(m) << ": " << nodes << "\n";
+        }
+        std::cout << "\n";
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "Nodes: " << result.nodes << "\n";
+    std::cout << "Time:  " << static_cast<u64>(seconds * 1000) << " ms\n";
+    std::cout << "NPS:   " << static_cast<u64>(seconds > 0 ? result.nodes / seconds : 0) << "\n";
+
+    return 0;
+}
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "chess/game.hpp"
+#include "chess/nnue.hpp"
+#include "engine/engine.hpp"
+
+// Universal Chess Interface front end for the engine, reads commands from stdin.
+// The search runs on a worker thread so stop/ponderhit/isready are answered while it thinks.
+
+static chess::Game game;
+static chess::engine::SearchSignals signals;
+static std::thread search_thread;
+static std::mutex output_mutex; // info/bestmove lines come from the search thread
+static bool use_nnue = false;   // UseNNUE, applied once a network is loaded whatever order the options come in
+
+static void send(const std::string &line)
+{
+    std::lock_guard<std::mutex> lock(output_mutex);
+    std::cout << line << std::endl;
+}
+
+static void wait_for_search()
+{
+    if (search_thread.joinable())
+        search_thread.join();
+}
+
+static void stop_search()
+{
+    signals.stop = true;
+    signals.ponder = false;
+    wait_for_search();
+}
+
+static std::string format_info(const chess::engine::SearchResult &result)
+{
+    std::ostringstream ss;
+    ss << "info depth " << result.depth << " seldepth " << result.seldepth;
+    if (result.mate_in)
+        ss << " score mate " << result.mate_in;
+    else
+        ss << " score cp " << result.score;
+    ss << " nodes " << result.nodes << " nps " << result.nps << " hashfull " << result.hashfull << " time " << result.time_ms;
+
+    if (!result.pv.empty())
+    {
+        ss << " pv";
+        for (chess::Move m : result.pv)
+            ss << " " << chess::move::to_uci(m);
+    }
+    return ss.str();
+}
+
+// Finds the legal move written in coordinate notation, 0 if there is none
+static chess::Move parse_move(const chess::Game &g, const std::string &str)
+{
+    chess::Move moves[256];
+    std::size_t n_moves = g.get_moves(moves);
+    for (std::size_t i = 0; i < n_moves; ++i)
+    {
+        if (chess::move::to_uci(moves[i]) == str)
+            return moves[i];
+    }
+    return 0;
+}
+
+// position [startpos | fen <fen>] [moves <move>...]
+static void handle_position(std::istringstream &is)
+{
+    std::string token, fen;
+    is >> token;
+    if (token == "startpos")
+    {
+        fen = chess::default_fen;
+        is >> token; // "moves", if any
+    }
+    else if (token == "fen")
+    {
+        while (is >> token && token != "moves")
+            fen += (fen.empty() ? "" : " ") + token;
+    }
+    else
+        return;
+
+    chess::Game new_game;
+    try
+    {
+        new_game = chess::Game(fen);
+    }
+    catch (const std::exception &e)
+    {
+        send(std::string("info string invalid fen: ") + e.what());
+        return;
+    }
+
+    while (is >> token)
+    {
+        chess::Move m = parse_move(new_game, token);
+        if (!m)
+        {
+            send("info string illegal move: " + token);
+            break;
+        }
+        new_game.make_move(m);
+    }
+
+    game = new_game;
+}
+
+static void search_worker(chess::Game search_game, chess::engine::SearchLimits limits, bool infinite)
+{
+    chess::engine::SearchResult last_reported;
+    chess::engine::SearchResult result = chess::engine::solve(search_game, limits, [&](const chess::engine::SearchResult &r)
+                                                              { send(format_info(r));
+                                                                last_reported = r; });
+
+    // Only the main thread's iterations are reported, the result may be a helper's deeper one
+    if (result.depth != last_reported.depth || result.pv != last_reported.pv)
+        send(format_info(result));
+
+    // bestmove must not be sent before stop (or ponderhit) in infinite and ponder mode
+    while ((infinite || signals.ponder) && !signals.stop)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    std::string line = "bestmove " + (result.best_move ? chess::move::to_uci(result.best_move) : "0000");
+    if (result.ponder_move)
+        line += " ponder " + chess::move::to_uci(result.ponder_move);
+    send(line);
+}
+
+static void handle_go(std::istringstream &is)
+{
+    chess::engine::SearchLimits limits;
+    bool infinite = false, ponder = false;
+
+    std::string token;
+    while (is >> token)
+    {
+        if (token == "wtime")
+            is >> limits.wtime;
+        else if (token == "btime")
+            is >> limits.btime;
+        else if (token == "winc")
+            is >> limits.winc;
+        else if (token == "binc")
+            is >> limits.binc;
+        else if (token == "movestogo")
+            is >> limits.movestogo;
+        else if (token == "depth")
+            is >> limits.depth;
+        else if (token == "nodes")
+            is >> limits.nodes;
+        else if (token == "movetime")
+            is >> limits.movetime;
+        else if (token == "infinite")
+            infinite = true;
+        else if (token == "ponder")
+            ponder = true;
+    }
+
+    stop_search();
+    signals.stop = false;
+    signals.ponder = ponder;
+    limits.signals = &signals;
+
+    search_thread = std::thread(search_worker, game, limits, infinite);
+}
+
+// setoption name <id> [value <x>]
+static void handle_setoption(std::istringstream &is)
+{
+    std::string token, name, value;
+    is >> token; // "name"
+    while (is >> token && token != "value")
+        name += (name.empty() ? "" : " ") + token;
+    while (is >> token)
+        value += (value.empty() ? "" : " ") + token;
+
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    if (name == "hash")
+        chess::engine::set_hash_size(std::max(1, std::atoi(value.c_str())));
+    else if (name == "threads")
+        chess::engine::set_threads(std::atoi(value.c_str()));
+    else if (name == "clear hash")
+        chess::engine::clear_hash();
+    else if (name == "nullmove")
+        chess::engine::set_null_move_pruning(value == "true");
+    else if (name == "lmr")
+        chess::engine::set_late_move_reductions(value == "true");
+    else if (name == "evalfile")
+    {
+        if (value.empty() || value == "<empty>")
+            return;
+        try
+        {
+            chess::nnue::load(value);
+            chess::nnue::set_enabled(use_nnue);
+            chess::engine::clear_hash(); // scores from the other evaluation would linger
+            send("info string loaded network " + value + " (" + chess::nnue::simd_name() + ")");
+        }
+        catch (const std::exception &e)
+        {
+            send(std::string("info string ") + e.what());
+        }
+    }
+    else if (name == "usennue")
+    {
+        use_nnue = value == "true";
+        chess::nnue::set_enabled(use_nnue);
+        chess::engine::clear_hash();
+        if (use_nnue && !chess::nnue::loaded())
+            send("info string no network loaded yet, UseNNUE takes effect once EvalFile is set");
+    }
+    else if (name == "ponder")
+        ; // pondering is driven by the GUI through "go ponder"
+    else
+        send("info string unknown option: " + name);
+}
+
+int main()
+{
+    std::ios::sync_with_stdio(false);
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        std::istringstream is(line);
+        std::string command;
+        is >> command;
+
+        if (command == "uci")
+        {
+            send("id name chess");
+            send("id author Connor Tynan");
+            send("option name Hash type spin default 16 min 1 max 65536");
+            send("option name Threads type spin default 1 min 1 max " + std::to_string(chess::engine::MAX_THREADS));
+            send("option name Clear Hash type button");
+            send("option name Ponder type check default false");
+            send("option name NullMove type check default true");
+            send("option name LMR type check default true");
+            send("option name EvalFile type string default <empty>");
+            send("option name UseNNUE type check default false");
+            send("uciok");
+        }
+        else if (command == "isready")
+            send("readyok");
+        else if (command == "ucinewgame")
+        {
+            stop_search();
+            chess::engine::clear_hash();
+            game.reset();
+        }
+        else if (command == "position")
+        {
+            stop_search();
+            handle_position(is);
+        }
+        else if (command == "go")
+            handle_go(is);
+        else if (command == "stop")
+            stop_search();
+        else if (command == "ponderhit")
+            signals.ponder = false;
+        else if (command == "setoption")
+        {
+            stop_search();
+            handle_setoption(is);
+        }
+        else if (command == "quit")
+            break;
+    }
+
+    stop_search();
+    return 0;
+}
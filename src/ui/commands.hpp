@@ -30,6 +30,7 @@ namespace ui
         CMD_UNDO,        // 'u'
         CMD_REDO,        // 'r'
         CMD_TOGGLE_EVAL, // 'E'
+        CMD_MOVE_NOW,    // 'm'
     };
 
     Command get_command(int ch)
@@ -90,6 +91,8 @@ namespace ui
             return CMD_REDO;
         case 'E':
             return CMD_TOGGLE_EVAL;
+        case 'm':
+            return CMD_MOVE_NOW;
 
         default:
             return CMD_NONE;
@@ -1,9 +1,12 @@
 #include "ui/ui.hpp"
 
 #include <array>
+#include <atomic>
 #include <list>
+#include <mutex>
 #include <ncurses.h>
 #include <cassert>
+#include <thread>
 #include <unistd.h>
 #include <fstream>
 
@@ -12,7 +15,8 @@
 #include "engine/engine.hpp"
 #include "commands.hpp"
 
-static constexpr int ENGINE_DEPTH = 6;
+static constexpr int ENGINE_MOVETIME_MS = 1000;
+static constexpr int SEARCH_POLL_MS = 50; // input timeout while the engine thinks, also the sidebar refresh rate
 
 namespace ui
 {
@@ -107,6 +111,19 @@ namespace ui
         bool white_engine = false;
         bool black_engine = false;
 
+        // Engine search running in the background, on its own copy of the game
+        std::thread search_thread;
+        chess::engine::SearchSignals search_signals; // stop doubles as the cancellation token
+        std::atomic<bool> search_done{false};
+        bool searching = false;
+        bool pondering = false; // searching the position after ponder_move while the player thinks
+        chess::Move ponder_move = 0;
+        u64 ponder_base_key = 0; // position the player is thinking about
+        u64 ponder_key = 0;      // position the ponder search is for, after ponder_move
+        chess::engine::SearchResult search_result;
+        std::mutex search_info_mutex;
+        chess::engine::SearchResult search_info; // latest completed iteration, for the sidebar
+
         enum Mode
         {
             MD_STARTUP,
@@ -345,7 +362,26 @@ namespace ui
                 last_ply++;
                 y++;
             }
-            y = 21;
+            y = 20;
+
+            // Live engine output
+            if (searching)
+            {
+                std::lock_guard<std::mutex> lock(search_info_mutex);
+                if (search_info.depth > 0)
+                {
+                    char score[16];
+                    if (search_info.mate_in)
+                        snprintf(score, sizeof(score), "#%d", search_info.mate_in);
+                    else
+                        snprintf(score, sizeof(score), "%+.2f", search_info.score / 100.0);
+                    char line[48];
+                    snprintf(line, sizeof(line), "d%-2d %-6s %6lluk", search_info.depth, score,
+                             (unsigned long long)(search_info.nodes / 1000));
+                    mvwprintw(sidebar, y, 1, "%-22.22s", line); // cut at the sidebar width so it never wraps
+                }
+            }
+            y++;
 
             // Status message
             mvwprintw(sidebar, y++, 1, "%-22s", status.c_str());
@@ -376,6 +412,7 @@ namespace ui
             mvwprintw(dialogue, y++, 1, " %-14s %30s ", "Flip board", "F");
             mvwprintw(dialogue, y++, 1, " %-14s %30s ", "Undo/Redo", "u / r");
             mvwprintw(dialogue, y++, 1, " %-14s %30s ", "Underpromotion", "Ctrl+Space");
+            mvwprintw(dialogue, y++, 1, " %-14s %30s ", "Move now", "m");
             mvwprintw(dialogue, y++, 1, " %-14s %30s ", "Quit", "Q or Ctrl+C");
             y++;
             mvwprintw(dialogue, y, 1, " Press [Cancel] key to return ");
@@ -581,8 +618,11 @@ namespace ui
         state.init();
     }
 
+    static void cancel_engine_search();
     void cleanup()
     {
+        cancel_engine_search();
+
         if (state.game)
         {
             std::ofstream pgn_out("game.pgn");
@@ -690,19 +730,36 @@ namespace ui
     }
 
     static void handle_input(int ch);
+    static bool finish_engine_search();
     void wait_for_input()
     {
-        if (state.mode == State::MD_SELECT && engine_turn())
-        {
-            display();
-            return;
-        }
+        if (state.mode == State::MD_SELECT && !state.searching)
+            engine_turn();
+        else if (state.mode == State::MD_GAME_OVER)
+            cancel_engine_search(); // drops a ponder search the game ended under
 
         while (true)
         {
             int ch = getch();
             if (ch == ERR)
+            {
+                // Timed out, only happens while the engine is thinking
+                if (!state.searching)
+                    continue;
+
+                if (state.search_done)
+                {
+                    finish_engine_search();
+                    return;
+                }
+
+                if (state.mode != State::MD_HELP)
+                {
+                    state.draw_sidebar();
+                    doupdate();
+                }
                 continue;
+            }
 
             if (ch == KEY_RESIZE)
             {
@@ -749,52 +806,172 @@ namespace ui
         return state.move_count > 0 || state.game->is_draw();
     }
 
+    // Called on the search thread after every completed iteration
+    static void publish_search_info(const chess::engine::SearchResult &info)
+    {
+        std::lock_guard<std::mutex> lock(state.search_info_mutex);
+        state.search_info = info;
+    }
+
+    static void search_worker(chess::Game game, chess::engine::SearchLimits limits)
+    {
+        state.search_result = chess::engine::solve(game, limits, publish_search_info);
+        state.search_done = true;
+    }
+
+    static void start_search(const chess::Game &game, bool ponder)
+    {
+        state.search_info = {};
+        state.search_signals.stop = false;
+        state.search_signals.ponder = ponder;
+        state.search_done = false;
+
+        chess::engine::SearchLimits limits;
+        limits.movetime = ENGINE_MOVETIME_MS; // counted from the ponder hit when pondering
+        limits.signals = &state.search_signals;
+
+        state.search_thread = std::thread(search_worker, game, limits);
+    }
+
+    // Stops the background search or ponder search (if any) and waits for it, its result is discarded.
+    // Leaves the status alone so a game over message survives the ponder search it ends.
+    static void cancel_engine_search()
+    {
+        if (!state.searching && !state.pondering)
+            return;
+
+        state.search_signals.stop = true;
+        state.search_signals.ponder = false;
+        state.search_thread.join();
+        state.searching = false;
+        state.pondering = false;
+        timeout(-1);
+    }
+
+    // Player vs engine: keep searching on the player's time, assuming they answer with
+    // the reply the engine expects. The search is only used if they actually do.
+    static void start_pondering()
+    {
+        if (state.white_engine == state.black_engine || !state.search_result.ponder_move)
+            return;
+
+        const chess::Move reply = state.search_result.ponder_move;
+        bool legal = false;
+        for (int i = 0; i < state.move_count; ++i)
+            legal |= state.moves[i] == reply;
+        if (!legal)
+            return;
+
+        chess::Game ponder_game = *state.game;
+        ponder_game.make_move(reply);
+
+        state.ponder_base_key = state.game->position.hash();
+        state.ponder_move = reply;
+        state.ponder_key = ponder_game.position.hash();
+        state.pondering = true;
+        start_search(ponder_game, true);
+    }
+
+    // Starts a background search if the engine is to move, returns true if one was started
     static bool engine_turn()
     {
+        // Ponder hit: the search is already running on this position, just start its clock.
+        // Otherwise once the player deviates (or takes a move back) the ponder search is dropped.
+        if (state.pondering)
+        {
+            const u64 key = state.game->position.hash();
+            if (key == state.ponder_key)
+            {
+                state.pondering = false;
+                state.searching = true;
+                state.search_signals.ponder = false;
+            }
+            else if (key != state.ponder_base_key)
+            {
+                cancel_engine_search();
+                state.status.clear();
+            }
+        }
+
         auto turn = state.game->position.turn();
         if ((turn == chess::Color::WHITE && state.white_engine) ||
             (turn == chess::Color::BLACK && state.black_engine))
         {
             state.status = "Engine thinking...";
-            state.draw_sidebar();
-            doupdate();
-            int eval = 0;
-            usleep(100000); // sleep for 100ms to simulate thinking time
-            chess::Move engine_move = chess::engine::solve(*state.game, ENGINE_DEPTH, &eval);
-            if (!engine_move)
+            if (!state.searching)
             {
-                state.status = "Engine error!";
-                state.mode = State::MD_GAME_OVER;
-                return false;
+                state.searching = true;
+                start_search(*state.game, false);
             }
 
-            if (!make_move(engine_move))
-            {
-                state.mode = State::MD_GAME_OVER;
-                bool check = state.game->position.king_checked(state.game->position.turn());
-                state.status = state.game->is_draw()
-                                   ? "Draw!"
-                                   : (check
-                                          ? (state.game->position.turn() == chess::Color::WHITE
-                                                 ? "Checkmate! Black wins!"
-                                                 : "Checkmate! White wins!")
-                                          : "Stalemate!");
-                display();
-                return false;
-            }
-
-            state.status.clear();
-            state.update();
+            // Poll for input so the sidebar keeps updating while the engine thinks
+            timeout(SEARCH_POLL_MS);
+            state.draw_sidebar();
+            doupdate();
             return true;
         }
 
         return false;
     }
 
+    // Plays the move found by the finished background search, returns false if the game ended
+    static bool finish_engine_search()
+    {
+        state.search_thread.join();
+        state.searching = false;
+        timeout(-1);
+
+        chess::Move engine_move = state.search_result.best_move;
+        if (!engine_move)
+        {
+            state.status = "Engine error!";
+            state.mode = State::MD_GAME_OVER;
+            return false;
+        }
+
+        if (!make_move(engine_move))
+        {
+            state.mode = State::MD_GAME_OVER;
+            bool check = state.game->position.king_checked(state.game->position.turn());
+            state.status = state.game->is_draw()
+                               ? "Draw!"
+                               : (check
+                                      ? (state.game->position.turn() == chess::Color::WHITE
+                                             ? "Checkmate! Black wins!"
+                                             : "Checkmate! White wins!")
+                                      : "Stalemate!");
+            return false;
+        }
+
+        state.status.clear();
+        state.update();
+        start_pondering();
+        return true;
+    }
+
     static void handle_input(int ch)
     {
         Command cmd = get_command(ch);
 
+        // Only view commands while the engine thinks, the game can't change under it
+        if (state.searching)
+        {
+            switch (cmd)
+            {
+            case CMD_QUIT:
+            case CMD_HELP:
+            case CMD_DESELECT:
+            case CMD_FLIP_BOARD:
+                break;
+            case CMD_MOVE_NOW:
+                state.search_signals.stop = true; // the search ends with its best move so far
+                return;
+            default:
+                beep();
+                return;
+            }
+        }
+
         switch (cmd)
         {
         case CMD_QUIT: